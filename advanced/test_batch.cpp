@@ -0,0 +1,37 @@
+#include <string>
+#include <vector>
+
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE_METHOD(SchemeTest, "ProgramsWithSeveralForms") {
+    ExpectEq("(define x 1) (set! x (+ x 1)) x", "2");
+    ExpectEq("(define (sq y) (* y y))\n(sq 3)\n'(1 2)", "(1 2)");
+    // Only the last result is printed, so earlier forms may evaluate to anything.
+    ExpectEq("(lambda (y) y) 5", "5");
+    ExpectSyntaxError("");
+    ExpectSyntaxError("(define q 1) (2");
+    ExpectNameError("q");
+    ExpectNameError("(define z 1) w z");
+    ExpectEq("z", "1");
+}
+
+TEST_CASE("RunAllReturnsEveryResult") {
+    Interpreter interpreter(0);
+    std::vector<std::string> expected = {"()", "(1 2)", "3", "#t"};
+    interpreter.Run("(define l '(1 2))");
+    REQUIRE(interpreter.RunAll("'() l (+ 1 2) (pair? l)") == expected);
+}
+
+TEST_CASE("RunBatchRunsProgramsInOrder") {
+    Interpreter interpreter(0);
+    std::vector<std::string> programs = {"(define x 10)", "(define y (+ x 1)) y", "(* x y)"};
+    auto results = interpreter.RunBatch(programs);
+    REQUIRE(results.size() == 3);
+    REQUIRE(results[1] == "11");
+    REQUIRE(results[2] == "110");
+
+    std::vector<std::string> failing = {"(set! x 1)", "(abs 1 2)", "(set! x 2)"};
+    REQUIRE_THROWS_AS(interpreter.RunBatch(failing), RuntimeError);
+    REQUIRE(interpreter.Run("x") == "1");
+}
@@ -21,3 +21,11 @@ TEST_CASE_METHOD(SchemeTest, "IfSyntax") {
     ExpectSyntaxError("(if)");
     ExpectSyntaxError("(if 1 2 3 4)");
 }
+
+TEST_CASE_METHOD(SchemeTest, "IfEvaluatesOnlyTheTakenBranch") {
+    ExpectEq("(if #t 1 (abs 1 2))", "1");
+    ExpectEq("(if #f (abs 1 2) 2)", "2");
+    ExpectEq("(if '() 1 2)", "1");
+    ExpectEq("(if 0 1 2)", "1");
+    ExpectRuntimeError("(if (abs 1 2) 1 2)");
+}
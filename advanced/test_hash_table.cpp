@@ -0,0 +1,93 @@
+#include <filesystem>
+#include <map>
+#include <random>
+
+#include "../hashtable.h"
+#include "../test/scheme_test.h"
+
+TEST_CASE_METHOD(SchemeTest, "HashTableOperations") {
+    ExpectNoError("(define t (make-hash-table))");
+    ExpectEq("(hash-table-count t)", "0");
+    ExpectNoError("(hash-table-set! t 1 10)");
+    ExpectNoError("(hash-table-set! t 'key 2)");
+    ExpectNoError("(hash-table-set! t \"text\" 3)");
+    ExpectNoError("(hash-table-set! t '(1 (2 3)) 4)");
+    ExpectEq("(hash-table-ref t '(1 (2 3)))", "4");
+    ExpectEq("(hash-table-ref t (string-append \"te\" \"xt\"))", "3");
+    ExpectEq("(hash-table-ref t (- (hash-table-ref t 'key) 1))", "10");
+    ExpectEq("(hash-table-count t)", "4");
+
+    ExpectNoError("(hash-table-set! t \"text\" 5)");
+    ExpectEq("(hash-table-ref t \"text\")", "5");
+    ExpectEq("(hash-table-count t)", "4");
+    ExpectNoError("(hash-table-delete! t \"text\")");
+    ExpectNoError("(hash-table-delete! t \"text\")");
+    ExpectEq("(hash-table-ref t \"text\" #f)", "#f");
+    ExpectEq("(hash-table-count t)", "3");
+    ExpectEq("t", "#<hash-table>");
+
+    ExpectRuntimeError("(hash-table-ref t \"text\")");
+    ExpectRuntimeError("(hash-table-ref '((1 . 2)) 1)");
+    ExpectRuntimeError("(hash-table-set! t 1)");
+    ExpectRuntimeError("(make-hash-table -1)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "HashTableGrows") {
+    ExpectNoError("(define t (make-hash-table 4))");
+    ExpectNoError("(define (fill n) (if (= n 0) 0 (fill-one n)))");
+    ExpectNoError("(define (fill-one n) (hash-table-set! t n (* n n)) (fill (- n 1)))");
+    ExpectNoError("(fill 1000)");
+    ExpectEq("(hash-table-count t)", "1000");
+    ExpectEq("(hash-table-ref t 777)", "603729");
+}
+
+TEST_CASE("HashTableMatchesMap") {
+    HashTable table;
+    std::map<int64_t, int64_t> expected;
+    std::mt19937 gen(7);
+    for (int i = 0; i < 20000; ++i) {
+        auto key = std::uniform_int_distribution<int64_t>(0, 500)(gen);
+        if (gen() % 3) {
+            table.Set(std::make_shared<Number>(key), std::make_shared<Number>(i));
+            expected[key] = i;
+        } else {
+            REQUIRE(table.Erase(std::make_shared<Number>(key)) == expected.erase(key));
+        }
+        REQUIRE(table.GetSize() == expected.size());
+    }
+    for (int64_t key = 0; key <= 500; ++key) {
+        auto value = table.Find(std::make_shared<Number>(key));
+        REQUIRE(!value == !expected.contains(key));
+        if (value) {
+            REQUIRE(As<Number>(*value)->GetValue() == expected[key]);
+        }
+    }
+}
+
+TEST_CASE("HashTableIsChargedToTheHeap") {
+    Interpreter interpreter(0);
+    interpreter.Run("(define t (make-hash-table 1000))");
+    REQUIRE(interpreter.GetHeapUsed() > 1000 * sizeof(uint64_t));
+    interpreter.Run("(define t 0)");
+    REQUIRE(interpreter.GetHeapUsed() < 1000);
+}
+
+TEST_CASE("HashTableSnapshot") {
+    auto path = (std::filesystem::temp_directory_path() / "scheme_test_table.snapshot").string();
+    {
+        Interpreter interpreter(0);
+        interpreter.Run("(define t (make-hash-table))");
+        interpreter.Run("(hash-table-set! t '(a b) \"ab\")");
+        interpreter.Run("(hash-table-set! t 'self t)");
+        interpreter.Run("(define v (vector 1 2))");
+        interpreter.Run("(hash-table-set! t v 12)");
+        interpreter.SaveSnapshot(path);
+    }
+    Interpreter interpreter(0);
+    interpreter.LoadSnapshot(path);
+    REQUIRE(interpreter.Run("(hash-table-count t)") == "3");
+    REQUIRE(interpreter.Run("(hash-table-ref t '(a b))") == "\"ab\"");
+    REQUIRE(interpreter.Run("(hash-table-count (hash-table-ref t 'self))") == "3");
+    REQUIRE(interpreter.Run("(hash-table-ref t (vector 1 2))") == "12");
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,63 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE("InterpretersHaveSeparateGlobals") {
+    Interpreter first(0);
+    Interpreter second(0);
+    first.Run("(define isolated 1)");
+    second.Run("(define isolated 2)");
+    first.Run("(define + -)");
+    REQUIRE(first.Run("isolated") == "1");
+    REQUIRE(second.Run("isolated") == "2");
+    REQUIRE(first.Run("(+ 5 3)") == "2");
+    REQUIRE(second.Run("(+ 5 3)") == "8");
+    REQUIRE_THROWS_AS(Interpreter(0).Run("isolated"), NameError);
+}
+
+TEST_CASE("InterpretersRunConcurrently") {
+    constexpr int kThreads = 8;
+    constexpr int kRounds = 20;
+    std::atomic<int> failures = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([i, &failures] {
+            Interpreter interpreter(0);
+            try {
+                interpreter.Run("(define offset " + std::to_string(i) + ")");
+                interpreter.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+                interpreter.Run("(define (shifted n) (+ (fib n) offset))");
+                for (int round = 0; round < kRounds; ++round) {
+                    if (interpreter.Run("(shifted 15)") != std::to_string(610 + i)) {
+                        ++failures;
+                    }
+                    interpreter.Run("(set! offset (+ offset " + std::to_string(kThreads) + "))");
+                    interpreter.Run("(set! offset (- offset " + std::to_string(kThreads) + "))");
+                }
+            } catch (...) {
+                ++failures;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(failures == 0);
+}
+
+TEST_CASE("ResetForgetsGlobals") {
+    Interpreter interpreter(2);
+    interpreter.Run("(define car cdr)");
+    interpreter.Run("(define (map f l) 0)");
+    interpreter.Run("(define x (list 1 2 3))");
+    interpreter.Run("(define pending (future (+ 1 2)))");
+    interpreter.Reset();
+    REQUIRE(interpreter.Run("(car '(1 2))") == "1");
+    REQUIRE(interpreter.Run("(map abs '(-1))") == "(1)");
+    REQUIRE_THROWS_AS(interpreter.Run("x"), NameError);
+    REQUIRE(interpreter.GetHeapUsed() == 0);
+}
@@ -1,6 +1,7 @@
 #include <string>
 #include <iostream>
 
+#include "../compiler.h"
 #include "../test/scheme_test.h"
 #include "catch.hpp"
 #include "allocations_checker.h"
@@ -124,3 +125,54 @@ TEST_CASE_METHOD(SchemeTest, "LambdaScopePrune") {
 
     REQUIRE(alloc_count - dealloc_count <= 15'000);
 }
+
+TEST_CASE_METHOD(SchemeTest, "LambdaParametersShadowGlobals") {
+    ExpectEq("((lambda (+) (+ 1 2)) -)", "-1");
+    ExpectNoError("(define x 1)");
+    ExpectEq("((lambda (x) (set! x 5) x) 2)", "5");
+    ExpectEq("x", "1");
+}
+
+TEST_CASE_METHOD(SchemeTest, "InternalDefinesStayLocal") {
+    ExpectNoError("(define (outer) (define inner-x 5) (define (inner) (* inner-x 2)) (inner))");
+    ExpectEq("(outer)", "10");
+    ExpectNameError("inner-x");
+    ExpectNameError("inner");
+}
+
+TEST_CASE_METHOD(SchemeTest, "HotLambdaTierUp") {
+    ExpectNoError("(define (sum-to n acc) (if (= n 0) acc (sum-to (- n 1) (+ acc n))))");
+    for (int i = 0; i < 200; ++i) {
+        ExpectEq("(sum-to 10 0)", "55");
+    }
+    ExpectEq("(sum-to 1000 0)", "500500");
+
+    ExpectNoError("(define mul *)");
+    ExpectNoError("(define (twice x) (mul x 2))");
+    for (int i = 0; i < 200; ++i) {
+        ExpectEq("(twice " + std::to_string(i) + ")", std::to_string(2 * i));
+    }
+    ExpectRuntimeError("(twice #t)");
+    ExpectEq("(twice 21)", "42");
+
+    ExpectNoError("(set! mul +)");
+    ExpectEq("(twice 21)", "23");
+    ExpectNoError("(define mul (lambda (x y) (- x y)))");
+    ExpectEq("(twice 21)", "19");
+}
+
+TEST_CASE_METHOD(SchemeTest, "InterpretedTailCallsRunInConstantStack") {
+#ifdef SCHEME_JIT
+    JitSuspension suspension;
+#endif
+    ExpectNoError("(define (loop n acc) (if (= n 0) acc (loop (- n 1) (+ acc 1))))");
+    ExpectEq("(loop 100000 0)", "100000");
+
+    ExpectNoError("(define (even? n) (if (= n 0) #t (odd? (- n 1))))");
+    ExpectNoError("(define (odd? n) (if (= n 0) #f (even? (- n 1))))");
+    ExpectEq("(even? 100001)", "#f");
+
+    ExpectNoError("(define (walk xs n) (if (null? xs) n (walk (cdr xs) (+ n 1))))");
+    ExpectNoError("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    ExpectEq("(walk (build 100000 '()) 0)", "100000");
+}
@@ -0,0 +1,85 @@
+#include <string>
+
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE("StepLimitStopsRunawayPrograms") {
+    Interpreter interpreter(0);
+    interpreter.SetLimits({.max_steps = 1000});
+    interpreter.Run("(define (loop n) (loop (+ n 1)))");
+    REQUIRE_THROWS_AS(interpreter.Run("(loop 0)"), LimitError);
+    // Every run gets the full limit again.
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+    interpreter.Run("(define (count n acc) (if (= n 0) acc (count (- n 1) (+ acc 1))))");
+    REQUIRE(interpreter.Run("(count 50 0)") == "50");
+    REQUIRE_THROWS_AS(interpreter.Run("(count 5000 0)"), LimitError);
+}
+
+TEST_CASE("DepthLimitStopsDeepRecursion") {
+    Interpreter interpreter(0);
+    interpreter.SetLimits({.max_depth = 500});
+    interpreter.Run("(define (deep n) (if (= n 0) 0 (+ 1 (deep (- n 1)))))");
+    REQUIRE(interpreter.Run("(deep 10)") == "10");
+    REQUIRE_THROWS_AS(interpreter.Run("(deep 100000)"), LimitError);
+    REQUIRE(interpreter.Run("(deep 20)") == "20");
+
+    std::string nested = std::string(1000, '(') + std::string(1000, ')');
+    REQUIRE_THROWS_AS(interpreter.Run(nested), LimitError);
+    std::string quoted = std::string(1000, '\'') + "1";
+    REQUIRE_THROWS_AS(interpreter.Run(quoted), LimitError);
+}
+
+TEST_CASE("HeapLimitStopsLargeAllocations") {
+    Interpreter interpreter(0);
+    interpreter.SetLimits({.max_heap_bytes = 1 << 16});
+    interpreter.Run("(define (range n acc) (if (= n 0) acc (range (- n 1) (cons n acc))))");
+    REQUIRE(interpreter.Run("(list-ref (range 10 '()) 9)") == "10");
+    REQUIRE_THROWS_AS(interpreter.Run("(define big (range 5000 '()))"), LimitError);
+    // Whatever the failed run allocated has been freed.
+    REQUIRE(interpreter.GetHeapUsed() < 1 << 16);
+    REQUIRE(interpreter.Run("(list-ref (range 10 '()) 0)") == "1");
+}
+
+TEST_CASE("LongListsDoNotCountAsDepth") {
+    Interpreter interpreter(0);
+    interpreter.SetLimits({.max_depth = 10});
+    std::string program = "(+";
+    for (int i = 0; i < 1000; ++i) {
+        program += " 1";
+    }
+    REQUIRE(interpreter.Run(program + ")") == "1000");
+}
+
+TEST_CASE("TailCallsDoNotCountAsDepth") {
+    Interpreter interpreter(0);
+    interpreter.SetLimits({.max_depth = 10});
+    interpreter.Run("(define (count n) (if (= n 0) 0 (count (- n 1))))");
+    REQUIRE(interpreter.Run("(count 1000)") == "0");
+}
+
+TEST_CASE("LimitsApplyToFuturesAndParallelMap") {
+    for (size_t workers : {0, 2}) {
+        CAPTURE(workers);
+        Interpreter interpreter(workers);
+        interpreter.SetParallelGrain(1);
+        interpreter.SetLimits({.max_steps = 20000, .max_depth = 300});
+        interpreter.Run("(define (loop n) (loop (+ n 1)))");
+        interpreter.Run("(define (deep n) (if (= n 0) 0 (+ 1 (deep (- n 1)))))");
+        interpreter.Run("(define (count n) (if (= n 0) 0 (count (- n 1))))");
+
+        REQUIRE_THROWS_AS(interpreter.Run("(touch (future (loop 0)))"), LimitError);
+        REQUIRE_THROWS_AS(interpreter.Run("(touch (future (deep 100000)))"), LimitError);
+        REQUIRE_THROWS_AS(interpreter.Run("(pmap loop '(1 2 3 4))"), LimitError);
+        REQUIRE_THROWS_AS(interpreter.Run("(pmap deep '(1 100000))"), LimitError);
+        REQUIRE(interpreter.Run("(touch (future (deep 50)))") == "50");
+        REQUIRE(interpreter.Run("(pmap deep '(1 2 3))") == "(1 2 3)");
+
+        // The steps of every task are charged to the run that started them.
+        std::string counts = "'(";
+        for (int i = 0; i < 1000; ++i) {
+            counts += " 50";
+        }
+        REQUIRE(interpreter.Run("(touch (future (count 50)))") == "0");
+        REQUIRE_THROWS_AS(interpreter.Run("(pmap count " + counts + "))"), LimitError);
+    }
+}
@@ -0,0 +1,63 @@
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE_METHOD(SchemeTest, "MemoizedFibonacci") {
+    ExpectNoError(R"EOF(
+        (define-memoized (memo-fib n)
+          (if (< n 2) n (+ (memo-fib (- n 1)) (memo-fib (- n 2)))))
+    )EOF");
+    ExpectEq("(memo-fib 30)", "832040");
+    ExpectEq("(memoize-stats memo-fib)", "(28 31)");
+    ExpectEq("(memo-fib 80)", "23416728348467685");
+}
+
+TEST_CASE_METHOD(SchemeTest, "MemoizeLeastRecentlyUsed") {
+    ExpectNoError("(define memo-square (memoize (lambda (x) (* x x)) 2))");
+    ExpectEq("(memo-square 1)", "1");
+    ExpectEq("(memo-square 2)", "4");
+    ExpectEq("(memo-square 1)", "1");
+    ExpectEq("(memo-square 3)", "9");
+    ExpectEq("(memo-square 1)", "1");
+    ExpectEq("(memo-square 2)", "4");
+    ExpectEq("(memoize-stats memo-square)", "(2 4)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "MemoizeStructuralKeys") {
+    ExpectNoError("(define memo-car (memoize car))");
+    ExpectEq("(memo-car '(1 2))", "1");
+    ExpectEq("(memo-car (list 1 2))", "1");
+    ExpectEq("(memo-car '(3 2))", "3");
+    ExpectEq("(memoize-stats memo-car)", "(1 2)");
+
+    ExpectRuntimeError("(memoize 1)");
+    ExpectRuntimeError("(memoize car 0)");
+    ExpectRuntimeError("(memoize-stats car)");
+    ExpectSyntaxError("(define-memoized memo-x 1)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "EqualWalksLongLists") {
+    std::string list = "'(";
+    for (int i = 0; i < 100000; ++i) {
+        list += std::to_string(i) + " ";
+    }
+    ExpectEq("(equal? " + list + ") " + list + "))", "#t");
+    ExpectEq("(equal? " + list + ") " + list + "1))", "#f");
+}
+
+TEST_CASE("StructuralHashCoversWholeLists") {
+    auto make_list = [](int last) {
+        std::shared_ptr<Object> list =
+            std::make_shared<Cell>(std::make_shared<Number>(last), nullptr);
+        for (int i = 0; i < 1000; ++i) {
+            list = std::make_shared<Cell>(std::make_shared<Number>(i), list);
+        }
+        return list;
+    };
+    REQUIRE(StructuralHash(make_list(1)) == StructuralHash(make_list(1)));
+    REQUIRE(StructuralHash(make_list(1)) != StructuralHash(make_list(2)));
+
+    auto cyclic = std::make_shared<Cell>(std::make_shared<Number>(1), nullptr);
+    cyclic->SetSecond(std::make_shared<Cell>(std::make_shared<Number>(2), cyclic));
+    StructuralHash(cyclic);
+    cyclic->SetSecond(nullptr);
+}
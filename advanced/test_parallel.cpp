@@ -0,0 +1,46 @@
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE_METHOD(SchemeTest, "ParallelMap") {
+    ExpectNoError(R"EOF(
+        (define (par-range a b acc)
+          (if (= a b) acc (par-range a (- b 1) (cons (- b 1) acc))))
+    )EOF");
+    ExpectNoError("(define par-squares (pmap (lambda (x) (* x x)) (par-range 0 1000 '())))");
+    ExpectEq("(list-ref par-squares 999)", "998001");
+    ExpectEq("(apply + par-squares)", "332833500");
+    ExpectEq("(pmap abs '(-1 2 -3))", "(1 2 3)");
+    ExpectEq("(pmap abs '())", "()");
+
+    ExpectRuntimeError("(pmap 1 '(1 2))");
+    ExpectRuntimeError("(pmap (lambda (x) (/ x 0)) (par-range 0 1000 '()))");
+}
+
+TEST_CASE_METHOD(SchemeTest, "FuturesAndTouch") {
+    ExpectNoError("(define (par-fib n) (if (< n 2) n (+ (par-fib (- n 1)) (par-fib (- n 2)))))");
+    ExpectNoError("(define par-left (future (par-fib 20)))");
+    ExpectNoError("(define par-right (future (par-fib 19)))");
+    ExpectEq("(+ (touch par-left) (touch par-right))", "10946");
+    ExpectEq("(touch (future (touch (future 7))))", "7");
+    ExpectEq("(touch 5)", "5");
+
+    ExpectSyntaxError("(future)");
+    ExpectRuntimeError("(touch (future (/ 1 0)))");
+    ExpectNoError("(define par-counter 0)");
+    ExpectRuntimeError("(touch (future (set! par-counter 1)))");
+    ExpectEq("par-counter", "0");
+}
+
+TEST_CASE("ParallelWorkerCount") {
+    for (size_t workers : {0, 1, 4}) {
+        Interpreter interpreter(workers);
+        interpreter.SetParallelGrain(1);
+        interpreter.Run(R"EOF(
+            (define (pw-range a b acc)
+              (if (= a b) acc (pw-range a (- b 1) (cons (- b 1) acc))))
+        )EOF");
+        REQUIRE(interpreter.Run("(apply + (pmap (lambda (x) (+ x 1)) (pw-range 0 100 '())))") ==
+                "5050");
+        REQUIRE(interpreter.Run("(touch (future (* 6 7)))") == "42");
+    }
+}
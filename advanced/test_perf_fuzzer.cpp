@@ -0,0 +1,48 @@
+#include "../test/scheme_test.h"
+#include "../test/perf_fuzzer.h"
+#include "catch.hpp"
+
+// Allocations are counted exactly, so they get a tight bound. Time is too noisy on a shared
+// machine to fail on, so growth that looks clearly worse than linear is only reported.
+constexpr double kMaxAllocationExponent = 1.25;
+constexpr double kMaxTimeExponent = 1.6;
+
+TEST_CASE("GeneratedProgramsAreValid") {
+    ProgramGenerator gen;
+    Interpreter interpreter(0);
+    for (const auto& shape : GetProgramShapes()) {
+        for (size_t size : {1, 2, 10}) {
+            CAPTURE(shape.name, size);
+            REQUIRE_NOTHROW(interpreter.Run(shape.make(&gen, size)));
+        }
+    }
+}
+
+TEST_CASE("ProgramsScaleLinearly") {
+    for (const auto& shape : GetProgramShapes()) {
+        auto growth = MeasureGrowth(shape);
+        CAPTURE(shape.name, growth.allocation_exponent, growth.time_exponent);
+        CHECK(growth.allocation_exponent < kMaxAllocationExponent);
+        if (growth.time_exponent >= kMaxTimeExponent) {
+            WARN(shape.name << ": time grows as n^" << growth.time_exponent);
+        }
+    }
+}
+
+TEST_CASE("GrowthFlagsQuadraticPrograms") {
+    // Looks up every element of a list in its own copy of the list.
+    ProgramShape quadratic{"quadratic", 50, [](ProgramGenerator* gen, size_t n) {
+                               auto list = gen->Sequence(n, true);
+                               std::string program = "(max";
+                               for (size_t i = 0; i < n; ++i) {
+                                   program +=
+                                       " (list-ref '(" + list + ") " + std::to_string(i) + ")";
+                               }
+                               return program + ")";
+                           }};
+    auto growth = MeasureGrowth(quadratic);
+    REQUIRE(growth.allocation_exponent > 1.8);
+    if (growth.time_exponent <= kMaxTimeExponent) {
+        WARN("quadratic: time grows as n^" << growth.time_exponent);
+    }
+}
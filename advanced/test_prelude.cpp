@@ -0,0 +1,72 @@
+#include "../test/scheme_test.h"
+
+TEST_CASE_METHOD(SchemeTest, "PreludeListFunctions") {
+    ExpectEq("(map (lambda (x) (* x x)) '(1 2 3))", "(1 4 9)");
+    ExpectEq("(map (lambda (x) x) '())", "()");
+    ExpectEq("(filter (lambda (x) (> x 1)) '(3 1 2))", "(3 2)");
+    ExpectEq("(fold + 0 '(1 2 3 4))", "10");
+    ExpectEq("(fold cons '() '(1 2 3))", "(3 2 1)");
+    ExpectEq("(fold-right cons '() '(1 2 3))", "(1 2 3)");
+    ExpectEq("(length '(1 (2 3) 4))", "3");
+    ExpectEq("(reverse '(1 2 3))", "(3 2 1)");
+    ExpectEq("(append '(1 2) '(3 4))", "(1 2 3 4)");
+    ExpectEq("(append '() '(1))", "(1)");
+
+    ExpectEq("(equal? '(1 (2 3)) (cons 1 (cons '(2 3) '())))", "#t");
+    ExpectEq("(equal? '(1 2) '(1 3))", "#f");
+    ExpectEq("(member 2 '(1 2 3))", "(2 3)");
+    ExpectEq("(member 4 '(1 2 3))", "#f");
+    ExpectEq("(assoc \"b\" '((\"a\" 1) (\"b\" 2)))", "(\"b\" 2)");
+    ExpectEq("(assoc '(1) '((2 a) ((1) b)))", "((1) b)");
+    ExpectEq("(assoc 3 '((1 a)))", "#f");
+
+    ExpectRuntimeError("(map car '(1 2))");
+    ExpectRuntimeError("(length 1)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "PreludeCanBeRedefined") {
+    ExpectNoError("(define (reverse l) l)");
+    ExpectEq("(reverse '(1 2))", "(1 2)");
+    ExpectEq("(fold cons '() '(1 2))", "(2 1)");
+}
+
+TEST_CASE("PreludeIsPerInterpreter") {
+    Interpreter first(0);
+    Interpreter second(0);
+    REQUIRE(first.GetHeapUsed() == 0);
+    first.Run("(define (map f l) 0)");
+    REQUIRE(first.Run("(map car '((1)))") == "0");
+    REQUIRE(second.Run("(map car '((1)))") == "(1)");
+}
+
+TEST_CASE("PreludeIsLinear") {
+    Interpreter interpreter(0);
+    auto allocations = [&](int size) {
+        std::string list = "'(";
+        for (int i = 0; i < size; ++i) {
+            list += std::to_string(i) + " ";
+        }
+        list += ")";
+        auto before = interpreter.GetStats().allocations;
+        interpreter.Run("(length (filter (lambda (x) #t) (map (lambda (x) x) " + list + ")))");
+        return interpreter.GetStats().allocations - before;
+    };
+    auto small = allocations(500);
+    auto large = allocations(1000);
+    REQUIRE(large < small * 2.2);
+}
+
+TEST_CASE_METHOD(SchemeTest, "PreludeRunsInConstantStack") {
+    std::string list = "'(";
+    for (int i = 0; i < 100000; ++i) {
+        list += std::to_string(i) + " ";
+    }
+    list += ")";
+    ExpectNoError("(define xs " + list + ")");
+    ExpectEq("(length (map (lambda (x) (+ x 1)) xs))", "100000");
+    ExpectEq("(car (reverse (map (lambda (x) (+ x 1)) xs)))", "100000");
+    ExpectEq("(length (filter (lambda (x) (> x 49999)) xs))", "50000");
+    ExpectEq("(length (append xs xs))", "200000");
+    ExpectEq("(car (fold-right cons '() xs))", "0");
+    ExpectEq("(member 99999 xs)", "(99999)");
+}
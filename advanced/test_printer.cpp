@@ -0,0 +1,74 @@
+#include <sstream>
+#include <string>
+
+#include "../printer.h"
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE_METHOD(SchemeTest, "PrintNestedData") {
+    ExpectEq("'((1 2) 3)", "((1 2) 3)");
+    ExpectEq("'(1 (2 . 3) (() #t))", "(1 (2 . 3) (() #t))");
+    ExpectEq("(cons (vector 1 -2) '())", "(#(1 -2))");
+    ExpectEq("(quote '1)", "(quote 1)");
+    ExpectEq("(car '((1 2) 3))", "(1 2)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "PrintCycles") {
+    ExpectNoError("(define y '(1 2))");
+    ExpectNoError("(set-cdr! (cdr y) y)");
+    ExpectEq("y", "#0=(1 2 . #0#)");
+
+    ExpectNoError("(define x '(1 . 2))");
+    ExpectNoError("(set-car! x x)");
+    ExpectEq("x", "#0=(#0# . 2)");
+
+    ExpectNoError("(define v (vector 1 2))");
+    ExpectNoError("(vector-set! v 1 v)");
+    ExpectEq("v", "#0=#(1 #0#)");
+
+    ExpectRuntimeError("(set-car! 1 2)");
+    ExpectRuntimeError("(set-cdr! x)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "PrintSharedStructure") {
+    ExpectNoError("(define a '(1))");
+    ExpectEq("(cons a (cons a '()))", "(#0=(1) #0#)");
+    ExpectEq("(cons a a)", "(#0=(1) . #0#)");
+}
+
+TEST_CASE("PrintLargeData") {
+    const int size = 100000;
+    std::shared_ptr<Object> flat;
+    std::shared_ptr<Object> deep;
+    for (int i = 0; i < size; ++i) {
+        flat = std::make_shared<Cell>(std::make_shared<Number>(1), flat);
+    }
+    for (int i = 0; i < size / 10; ++i) {
+        deep = std::make_shared<Cell>(deep, nullptr);
+    }
+
+    std::string out;
+    Print(flat, &out);
+    REQUIRE(out.size() == 2 * size + 1);
+    REQUIRE(out.substr(0, 6) == "(1 1 1");
+
+    std::stringstream stream;
+    Print(deep, &stream);
+    REQUIRE(stream.str() == std::string(size / 10, '(') + "()" + std::string(size / 10, ')'));
+
+    // Lists are released one cell at a time, so that destroying them does not recurse either.
+    while (Is<Cell>(flat)) {
+        flat = As<Cell>(flat)->GetSecond();
+    }
+    while (Is<Cell>(deep)) {
+        deep = As<Cell>(deep)->GetFirst();
+    }
+}
+
+TEST_CASE_METHOD(SchemeTest, "PrintingDoesNotEvaluateAgain") {
+    ExpectNoError("(define n 0)");
+    ExpectNoError("(define (mk) (set! n (+ n 1)) list)");
+    ExpectEq("((mk) 1 2)", "(1 2)");
+    ExpectEq("n", "1");
+    ExpectRuntimeError("(1 2)");
+}
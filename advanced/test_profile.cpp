@@ -0,0 +1,38 @@
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE("ProfileIsOptIn") {
+    Interpreter interpreter(0);
+    interpreter.Run("(cons 1 2)");
+    REQUIRE(interpreter.GetProfile() == nullptr);
+    REQUIRE(interpreter.GetLastRunPeak() > 0);
+}
+
+TEST_CASE("ProfileAttributesAllocations") {
+    Interpreter interpreter(0);
+    interpreter.EnableProfiling();
+    interpreter.Run("(define (pairs n acc) (if (= n 0) acc (pairs (- n 1) (cons n acc))))");
+    interpreter.Run("(define l (pairs 100 '()))");
+    interpreter.Run("(define v (make-vector 1000 0))");
+
+    auto profile = interpreter.GetProfile();
+    REQUIRE(profile->GetRuns() == 3);
+    auto types = profile->GetTypes();
+    REQUIRE(types["Cell"].allocations >= 100);
+    REQUIRE(types["Scope"].allocations >= 100);
+    REQUIRE(types["vector buffer"].bytes >= 1000 * sizeof(std::shared_ptr<Object>));
+    // The scopes of the finished calls are gone, the list they built is kept.
+    REQUIRE(types["Scope"].frees >= 100);
+    REQUIRE(types["Cell"].bytes - types["Cell"].freed_bytes >= 100 * sizeof(Cell));
+
+    auto sites = profile->GetSites();
+    REQUIRE(sites["cons"].allocations >= 100);
+    REQUIRE(sites["closure"].allocations >= 100);
+    REQUIRE(sites["make-vector"].bytes >= 1000 * sizeof(std::shared_ptr<Object>));
+    REQUIRE(sites["read"].allocations > 0);
+
+    REQUIRE(interpreter.GetLastRunPeak() >= 1000 * sizeof(std::shared_ptr<Object>));
+    REQUIRE(profile->GetMaxPeak() >= interpreter.GetLastRunPeak());
+    auto report = profile->Report();
+    REQUIRE(report.find("make-vector") != std::string::npos);
+}
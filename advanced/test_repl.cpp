@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <string>
+
+#include <unistd.h>
+
+#include "../repl/session.h"
+#include "catch.hpp"
+
+namespace {
+
+// Feeds the input to a session in `--pipe` mode and returns what it wrote to stdout.
+std::string RunRepl(const std::string& input, size_t* errors = nullptr) {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    REQUIRE(write(fds[1], input.data(), input.size()) == static_cast<ssize_t>(input.size()));
+    close(fds[1]);
+
+    FILE* out = std::tmpfile();
+    REQUIRE(out != nullptr);
+    ReplOptions options;
+    options.pipe = true;
+    {
+        Session session(options, fileno(out), fileno(out));
+        REQUIRE(session.Process(fds[0]));
+        if (errors) {
+            *errors = session.GetErrors();
+        }
+    }
+    close(fds[0]);
+
+    std::string output;
+    std::rewind(out);
+    for (int c; (c = std::fgetc(out)) != EOF;) {
+        output.push_back(static_cast<char>(c));
+    }
+    std::fclose(out);
+    return output;
+}
+
+}  // namespace
+
+TEST_CASE("ReplEvaluatesLineByLine") {
+    REQUIRE(RunRepl("(+ 1 2)\n(* 2 3) (- 1)\n") == "3\n6\n-1\n");
+}
+
+TEST_CASE("ReplContinuesOpenForms") {
+    REQUIRE(RunRepl("(define (f x)\n  (* x\n     x))\n(f 3)\n") == "()\n9\n");
+    REQUIRE(RunRepl("(+ 1\n2)") == "3\n");
+}
+
+// A failing line evaluated together with its neighbours would take their results with it.
+TEST_CASE("ReplIgnoresBracketsInStrings") {
+    REQUIRE(RunRepl("(string-length \"(\")\n(car '())\n(+ 1 2)\n") ==
+            "1\nerror: RuntimeError\n3\n");
+    REQUIRE(RunRepl("(string-length \")\")\n(car '())\n(+ 1 2)\n") ==
+            "1\nerror: RuntimeError\n3\n");
+    REQUIRE(RunRepl("(string-length \"\\\"(\")\n(car '())\n(+ 1 2)\n") ==
+            "2\nerror: RuntimeError\n3\n");
+}
+
+TEST_CASE("ReplContinuesOpenStrings") {
+    REQUIRE(RunRepl("(string-length \"a\n)b\")\n(car '())\n(+ 1 2)\n") ==
+            "4\nerror: RuntimeError\n3\n");
+}
+
+TEST_CASE("ReplReportsErrorsAndGoesOn") {
+    size_t errors = 0;
+    REQUIRE(RunRepl("(car '())\n(+ 1 2)\n", &errors) == "error: RuntimeError\n3\n");
+    REQUIRE(errors == 1);
+    REQUIRE(RunRepl("(+ 1 @)\n(+ 1 2)\n", &errors) == "error: SyntaxError\n3\n");
+    REQUIRE(errors == 1);
+}
@@ -0,0 +1,88 @@
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+#include <map>
+#include <sstream>
+
+namespace {
+
+// Sample counts of the stacks in folded output, keyed by stack.
+std::map<std::string, uint64_t> ParseFolded(const std::string& folded) {
+    std::map<std::string, uint64_t> stacks;
+    std::istringstream in(folded);
+    std::string line;
+    while (std::getline(in, line)) {
+        auto space = line.rfind(' ');
+        REQUIRE(space != std::string::npos);
+        stacks[line.substr(0, space)] += std::stoull(line.substr(space + 1));
+    }
+    return stacks;
+}
+
+}  // namespace
+
+TEST_CASE("SamplingIsOptIn") {
+    Interpreter interpreter(0);
+    interpreter.Run("(+ 1 2)");
+    REQUIRE(interpreter.GetSampler() == nullptr);
+}
+
+TEST_CASE("SamplerFoldsNamedStacks") {
+    Interpreter interpreter(0);
+    interpreter.EnableSampling(10);
+    interpreter.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    interpreter.Run("(define loop (lambda (n) (if (= n 0) 0 (loop (- n 1)))))");
+    REQUIRE(interpreter.Run("(fib 15)") == "610");
+    REQUIRE(interpreter.Run("(loop 500)") == "0");
+
+    auto sampler = interpreter.GetSampler();
+    REQUIRE(sampler->GetSamples() > 100);
+    auto stacks = ParseFolded(sampler->GetFolded());
+    uint64_t total = 0;
+    uint64_t in_fib = 0;
+    uint64_t in_loop = 0;
+    for (const auto& [stack, count] : stacks) {
+        total += count;
+        if (stack.starts_with("fib")) {
+            in_fib += count;
+            // Builtins only show up as the innermost frame.
+            REQUIRE(stack.find("+;") == std::string::npos);
+        }
+        in_loop += stack.starts_with("loop") ? count : 0;
+        REQUIRE(stack.find("lambda") == std::string::npos);
+    }
+    REQUIRE(total == sampler->GetSamples());
+    REQUIRE(in_fib > 0);
+    REQUIRE(in_loop > 0);
+    REQUIRE(in_fib > in_loop);
+}
+
+TEST_CASE("SamplerKeepsLimits") {
+    Interpreter interpreter(0);
+    interpreter.EnableSampling(7);
+    interpreter.SetLimits({.max_steps = 100});
+    interpreter.Run("(define (loop n) (if (= n 0) 0 (loop (- n 1))))");
+    REQUIRE_THROWS_AS(interpreter.Run("(loop 1000)"), LimitError);
+    REQUIRE(interpreter.Run("(loop 10)") == "0");
+    REQUIRE(interpreter.GetSampler()->GetSamples() > 0);
+}
+
+TEST_CASE("SamplerFollowsTasks") {
+    Interpreter interpreter(2);
+    interpreter.SetParallelGrain(1);
+    interpreter.EnableSampling(10);
+    interpreter.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    interpreter.Run("(define (spread l) (pmap fib l))");
+    REQUIRE(interpreter.Run("(spread '(15 15 15 15 15 15 15 15))") ==
+            "(610 610 610 610 610 610 610 610)");
+
+    // Samples taken on the workers hang below the frames the tasks were submitted from.
+    uint64_t in_fib = 0;
+    for (const auto& [stack, count] : ParseFolded(interpreter.GetSampler()->GetFolded())) {
+        if (stack.find("fib") != std::string::npos) {
+            REQUIRE(stack.starts_with("spread;fib"));
+            in_fib += count;
+        }
+    }
+    REQUIRE(in_fib > 100);
+}
@@ -0,0 +1,45 @@
+#include <future>
+#include <vector>
+
+#include "../scheduler.h"
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE("SchedulerInterleavesPrograms") {
+    Interpreter runaway(0);
+    Interpreter quick(0);
+    runaway.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    std::future<std::string> slow;
+    std::future<std::string> fast;
+    {
+        Scheduler scheduler(1, 1000);
+        slow = scheduler.Submit(&runaway, "(fib 25)");
+        fast = scheduler.Submit(&quick, "(+ 1 2)");
+        // The short program finishes while the long one is still running on the same thread.
+        REQUIRE(fast.get() == "3");
+        REQUIRE(slow.wait_for(std::chrono::seconds(0)) == std::future_status::timeout);
+    }
+    REQUIRE(slow.get() == "75025");
+}
+
+TEST_CASE("SchedulerRunsProgramsOfAnInterpreterInOrder") {
+    std::vector<std::unique_ptr<Interpreter>> interpreters;
+    std::vector<std::future<std::string>> results;
+    {
+        Scheduler scheduler(2, 100);
+        for (int i = 0; i < 20; ++i) {
+            interpreters.push_back(std::make_unique<Interpreter>(0));
+            auto interpreter = interpreters.back().get();
+            scheduler.Submit(interpreter, "(define (count n acc) (if (= n 0) acc (count (- n 1) "
+                                          "(+ acc 1))))");
+            scheduler.Submit(interpreter, "(define total (count " + std::to_string(i * 100) +
+                                              " 0))");
+            results.push_back(scheduler.Submit(interpreter, "total"));
+        }
+        auto failed = scheduler.Submit(interpreters[0].get(), "(abs 1 2)");
+        REQUIRE_THROWS_AS(failed.get(), RuntimeError);
+    }
+    for (int i = 0; i < 20; ++i) {
+        REQUIRE(results[i].get() == std::to_string(i * 100));
+    }
+}
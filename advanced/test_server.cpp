@@ -0,0 +1,144 @@
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../server/server.h"
+#include "catch.hpp"
+
+namespace {
+
+// A server with a single interpreter on a socket of its own, serving on a thread until
+// destroyed.
+class TestServer {
+public:
+    explicit TestServer(std::chrono::milliseconds idle_timeout = {}) {
+        ServerOptions options;
+        options.interpreters = 1;
+        options.workers = 2;
+        options.idle_timeout = idle_timeout;
+        options.socket = (std::filesystem::temp_directory_path() /
+                          ("scheme_test_" + std::to_string(getpid()) + ".sock"))
+                             .string();
+        path_ = options.socket;
+        server_ = std::make_unique<Server>(options);
+        REQUIRE(server_->Listen());
+        thread_ = std::thread([this] { server_->Serve(); });
+    }
+
+    ~TestServer() {
+        Stop();
+    }
+
+    void Stop() {
+        if (thread_.joinable()) {
+            server_->Stop();
+            thread_.join();
+        }
+    }
+
+    // Blocking client socket; reads give up after a few seconds instead of hanging the test.
+    int Connect() const {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        path_.copy(address.sun_path, sizeof(address.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        REQUIRE(fd >= 0);
+        REQUIRE(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+        timeval timeout{.tv_sec = 5, .tv_usec = 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+private:
+    std::string path_;
+    std::unique_ptr<Server> server_;
+    std::thread thread_;
+};
+
+void Send(int fd, const std::string& program) {
+    std::string request;
+    protocol::AppendRequest(&request, program);
+    REQUIRE(protocol::WriteAll(fd, request));
+}
+
+std::string Receive(int fd) {
+    protocol::Status status;
+    std::string payload;
+    REQUIRE(protocol::ReadResponse(fd, &status, &payload));
+    return payload;
+}
+
+std::string Eval(int fd, const std::string& program) {
+    Send(fd, program);
+    return Receive(fd);
+}
+
+bool IsClosed(int fd) {
+    char byte;
+    return read(fd, &byte, 1) == 0;
+}
+
+}  // namespace
+
+TEST_CASE("ServerResetsInterpretersBetweenConnections") {
+    TestServer server;
+    int first = server.Connect();
+    REQUIRE(Eval(first, "(define car cdr)") == "()");
+    REQUIRE(Eval(first, "(define x 1)") == "()");
+    REQUIRE(Eval(first, "(car '(1 2))") == "(2)");
+    close(first);
+
+    // The only interpreter is handed over once the first connection is gone.
+    int second = server.Connect();
+    REQUIRE(Eval(second, "(car '(1 2))") == "1");
+    REQUIRE(Eval(second, "x") == "NameError");
+    REQUIRE(Eval(second, "(map abs '(-1))") == "(1)");
+    close(second);
+}
+
+TEST_CASE("ServerAnswersRequestsSentBeforeShutdown") {
+    TestServer server;
+    int fd = server.Connect();
+    Send(fd, "(define x 20)");
+    Send(fd, "(+ x 1)");
+    Send(fd, "(* x 2)");
+    REQUIRE(shutdown(fd, SHUT_WR) == 0);
+    REQUIRE(Receive(fd) == "()");
+    REQUIRE(Receive(fd) == "21");
+    REQUIRE(Receive(fd) == "40");
+    REQUIRE(IsClosed(fd));
+    close(fd);
+}
+
+TEST_CASE("ServerDrainsOnStop") {
+    TestServer server;
+    int fd = server.Connect();
+    Send(fd, "(define (loop n) (if (= n 0) 7 (loop (- n 1))))");
+    Send(fd, "(loop 100000)");
+    Send(fd, "(+ 1 2)");
+    // Returns once the requests already sent are answered.
+    server.Stop();
+    REQUIRE(Receive(fd) == "()");
+    REQUIRE(Receive(fd) == "7");
+    REQUIRE(Receive(fd) == "3");
+    REQUIRE(IsClosed(fd));
+    close(fd);
+}
+
+TEST_CASE("ServerClosesIdleConnections") {
+    TestServer server(std::chrono::milliseconds(100));
+    int idle = server.Connect();
+    REQUIRE(Eval(idle, "(define y 1)") == "()");
+
+    // Waits for the idle connection to give up the only interpreter.
+    int active = server.Connect();
+    REQUIRE(Eval(active, "y") == "NameError");
+    REQUIRE(IsClosed(idle));
+    close(idle);
+    close(active);
+}
@@ -0,0 +1,126 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "../snapshot.h"
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+namespace {
+
+std::string SnapshotPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+}  // namespace
+
+TEST_CASE("SnapshotRestoresDefinitions") {
+    auto path = SnapshotPath("scheme_test_definitions.snapshot");
+    {
+        Interpreter interpreter(0);
+        interpreter.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+        interpreter.Run("(define (make-counter) ((lambda (n) (lambda () (set! n (+ n 1)) n)) 0))");
+        interpreter.Run("(define counter (make-counter))");
+        interpreter.Run("(counter)");
+        interpreter.Run("(define data '(1 (2 #t) sym))");
+        interpreter.Run("(define cyclic (make-vector 2 7))");
+        interpreter.Run("(vector-set! cyclic 0 cyclic)");
+        interpreter.Run("(define-memoized (slow-square n) (* n n))");
+        interpreter.Run("(define ones (cons-stream 1 ones))");
+        interpreter.Run("(stream-cdr ones)");
+        interpreter.Run("(define abs -)");
+        interpreter.SaveSnapshot(path);
+    }
+    Interpreter interpreter(0);
+    interpreter.LoadSnapshot(path);
+    REQUIRE(interpreter.Run("(fib 15)") == "610");
+    REQUIRE(interpreter.Run("(counter)") == "2");
+    REQUIRE(interpreter.Run("(counter)") == "3");
+    REQUIRE(interpreter.Run("(list-ref data 1)") == "(2 #t)");
+    REQUIRE(interpreter.Run("(list-tail data 2)") == "(sym)");
+    REQUIRE(interpreter.Run("(vector-length (vector-ref (vector-ref cyclic 0) 0))") == "2");
+    REQUIRE(interpreter.Run("(vector-ref cyclic 1)") == "7");
+    REQUIRE(interpreter.Run("(slow-square 12)") == "144");
+    REQUIRE(interpreter.Run("(stream-car (stream-cdr (stream-cdr ones)))") == "1");
+    REQUIRE(interpreter.Run("(abs 5 3)") == "2");
+    REQUIRE(interpreter.Run("(max 5 3)") == "5");
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("SnapshotErrors") {
+    auto path = SnapshotPath("scheme_test_errors.snapshot");
+    Interpreter interpreter(0);
+    REQUIRE_THROWS_AS(interpreter.LoadSnapshot(SnapshotPath("scheme_test_missing.snapshot")),
+                      RuntimeError);
+    std::ofstream(path) << "SCMSNAP1 but truncated";
+    REQUIRE_THROWS_AS(interpreter.LoadSnapshot(path), RuntimeError);
+    interpreter.Run("(define pending (future 1))");
+    REQUIRE_THROWS_AS(interpreter.SaveSnapshot(path), RuntimeError);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("SnapshotRestoresCyclicLists") {
+    auto path = SnapshotPath("scheme_test_cyclic_lists.snapshot");
+    {
+        Interpreter interpreter(0);
+        interpreter.Run("(define ring (list 1 2))");
+        interpreter.Run("(set-cdr! (cdr ring) ring)");
+        interpreter.Run("(define nested (list 3))");
+        interpreter.Run("(set-car! nested nested)");
+        interpreter.SaveSnapshot(path);
+    }
+    Interpreter interpreter(0);
+    interpreter.LoadSnapshot(path);
+    REQUIRE(interpreter.Run("(car (cdr (cdr (cdr ring))))") == "2");
+    REQUIRE(interpreter.Run("nested") == "#0=(#0#)");
+    REQUIRE(interpreter.Run("ring") == "#0=(1 2 . #0#)");
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("SnapshotRejectsCorruptOffsets") {
+    auto path = SnapshotPath("scheme_test_offsets.snapshot");
+    Interpreter interpreter(0);
+    interpreter.Run("(define pair (cons 1 2))");
+    interpreter.SaveSnapshot(path);
+    std::string image;
+    {
+        std::ifstream in(path, std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // Points the payload of every record at the end of the address space, where an offset
+    // plus a size wraps around.
+    constexpr size_t kHeaderSize = 24;
+    constexpr size_t kRecordSize = 16;
+    uint32_t record_count;
+    std::memcpy(&record_count, image.data() + 8, sizeof(record_count));
+    for (uint32_t i = 0; i < record_count; ++i) {
+        uint64_t payload = ~uint64_t{3};
+        std::memcpy(image.data() + kHeaderSize + i * kRecordSize + 8, &payload, sizeof(payload));
+    }
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << image;
+    REQUIRE_THROWS_AS(interpreter.LoadSnapshot(path), RuntimeError);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("SnapshotImagesMustBeAligned") {
+    auto path = SnapshotPath("scheme_test_aligned.snapshot");
+    Interpreter interpreter(0);
+    interpreter.Run("(define x 1)");
+    interpreter.SaveSnapshot(path);
+    std::ifstream in(path, std::ios::binary);
+    std::string image{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    std::filesystem::remove(path);
+
+    std::vector<uint64_t> words(image.size() / 8 + 1);
+    auto buffer = reinterpret_cast<char*>(words.data());
+    std::memcpy(buffer + 1, image.data(), image.size());
+    Environment environment;
+    EnvironmentGuard environment_guard(&environment);
+    REQUIRE_THROWS_AS(ReadSnapshot(&environment, std::span<const char>(buffer + 1, image.size())),
+                      RuntimeError);
+    std::memcpy(buffer, image.data(), image.size());
+    ReadSnapshot(&environment, std::span<const char>(buffer, image.size()));
+    REQUIRE(Is<Number>(environment.Find("x")->value));
+}
@@ -0,0 +1,80 @@
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+TEST_CASE("StatsCountRuns") {
+    Interpreter interpreter(0);
+    interpreter.Run("(define a 3)");
+    REQUIRE(interpreter.Run("(+ a (* a a) (* a 2))") == "18");
+    REQUIRE_THROWS_AS(interpreter.Run("(car a)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1"), SyntaxError);
+
+    auto stats = interpreter.GetStats();
+    REQUIRE(stats.runs == 4);
+    REQUIRE(stats.failed_runs == 2);
+    REQUIRE(stats.builtin_calls["define"] == 1);
+    REQUIRE(stats.builtin_calls["+"] == 1);
+    REQUIRE(stats.builtin_calls["*"] == 2);
+    REQUIRE(stats.builtin_calls["car"] == 1);
+    REQUIRE(stats.evaluations == 5);
+    REQUIRE(stats.allocations > 0);
+    REQUIRE(stats.frees > 0);
+    REQUIRE(stats.allocated_bytes - stats.freed_bytes >= stats.heap_bytes);
+    REQUIRE(stats.peak_heap_bytes > 0);
+    REQUIRE(stats.parse_time.count() > 0);
+    REQUIRE(stats.eval_time.count() > 0);
+}
+
+TEST_CASE("StatsCountCalleeCache") {
+    Interpreter interpreter(0);
+    interpreter.Run("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n))))");
+    REQUIRE(interpreter.Run("(sum 50 0)") == "1275");
+    auto stats = interpreter.GetStats();
+    REQUIRE(stats.evaluations >= 51);
+    REQUIRE(stats.callee_cache_hits > 0);
+    REQUIRE(stats.callee_cache_misses > 0);
+}
+
+TEST_CASE("StatsCountMemoCalls") {
+    Interpreter interpreter(0);
+    interpreter.Run(R"EOF(
+        (define-memoized (memo-fib n)
+          (if (< n 2) n (+ (memo-fib (- n 1)) (memo-fib (- n 2)))))
+    )EOF");
+    interpreter.Run("(memo-fib 30)");
+    auto stats = interpreter.GetStats();
+    REQUIRE(stats.memo_hits == 28);
+    REQUIRE(stats.memo_misses == 31);
+}
+
+TEST_CASE("StatsIncludeParallelWorkers") {
+    for (size_t workers : {0, 4}) {
+        Interpreter interpreter(workers);
+        interpreter.SetParallelGrain(1);
+        interpreter.Run("(pmap (lambda (x) (* x x)) '(1 2 3 4 5 6 7 8))");
+        REQUIRE(interpreter.GetStats().builtin_calls["*"] == 8);
+    }
+}
+
+TEST_CASE("StatsExportPrometheus") {
+    auto path = std::filesystem::temp_directory_path() / "scheme_stats_test.prom";
+    {
+        Interpreter interpreter(0);
+        interpreter.ExportMetrics(path.string(), std::chrono::hours(1));
+        interpreter.Run("(define a 1)");
+        interpreter.Run("(+ a 2)");
+        auto text = ToPrometheus(interpreter.GetStats());
+        REQUIRE(text.find("# TYPE scheme_runs_total counter\nscheme_runs_total 2\n") !=
+                std::string::npos);
+        REQUIRE(text.find("scheme_builtin_calls_total{builtin=\"+\"} 1\n") != std::string::npos);
+        REQUIRE(text.find("scheme_callee_cache_total{result=\"hit\"}") != std::string::npos);
+    }
+    // The last dump is written when the interpreter goes away.
+    std::ifstream in(path);
+    std::string text(std::istreambuf_iterator<char>(in), {});
+    REQUIRE(text.find("scheme_runs_total 2\n") != std::string::npos);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,36 @@
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE_METHOD(SchemeTest, "PromisesAreMemoized") {
+    ExpectNoError("(define delay-calls 0)");
+    ExpectNoError(R"EOF(
+        (define delayed
+          (delay ((lambda () (set! delay-calls (+ delay-calls 1)) (* 6 7)))))
+    )EOF");
+    ExpectEq("delay-calls", "0");
+    ExpectEq("(force delayed)", "42");
+    ExpectEq("(force delayed)", "42");
+    ExpectEq("delay-calls", "1");
+    ExpectEq("(force 5)", "5");
+    ExpectEq("delayed", "#<promise>");
+}
+
+TEST_CASE_METHOD(SchemeTest, "InfiniteStreams") {
+    ExpectNoError("(define (integers-from n) (cons-stream n (integers-from (+ n 1))))");
+    ExpectNoError(R"EOF(
+        (define (stream-nth s k)
+          (if (= k 0) (stream-car s) (stream-nth (stream-cdr s) (- k 1))))
+    )EOF");
+    ExpectEq("(stream-car (stream-cdr (integers-from 5)))", "6");
+    ExpectEq("(stream-nth (integers-from 0) 1000)", "1000");
+    ExpectEq("(cons-stream 1 (+ 1 1))", "(1 . #<promise>)");
+    ExpectEq("(stream-null? '())", "#t");
+    ExpectEq("(stream-null? (integers-from 0))", "#f");
+}
+
+TEST_CASE_METHOD(SchemeTest, "StreamErrors") {
+    ExpectSyntaxError("(delay)");
+    ExpectSyntaxError("(cons-stream 1)");
+    ExpectRuntimeError("(stream-cdr '(1 2))");
+    ExpectRuntimeError("(stream-car 1)");
+}
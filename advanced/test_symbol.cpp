@@ -57,3 +57,24 @@ TEST_CASE_METHOD(SchemeTest, "CopySemantics") {
 TEST_CASE_METHOD(SchemeTest, "EvaluationOrder") {
     ExpectNameError("(define x x)");
 }
+
+TEST_CASE_METHOD(SchemeTest, "VariablesHoldAnyValue") {
+    ExpectEq("(define x '(1 2))", "()");
+    ExpectEq("x", "(1 2)");
+    ExpectEq("(set! x #t)", "()");
+    ExpectEq("x", "#t");
+
+    ExpectNoError("(define first car)");
+    ExpectEq("(first '(3 4))", "3");
+}
+
+TEST_CASE_METHOD(SchemeTest, "RebindingBuiltins") {
+    ExpectNoError("(define plus +)");
+    ExpectEq("(plus 1 2)", "3");
+
+    ExpectNoError("(define + -)");
+    ExpectEq("(+ 5 2)", "3");
+
+    ExpectNoError("(set! + plus)");
+    ExpectEq("(+ 5 2)", "7");
+}
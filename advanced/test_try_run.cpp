@@ -0,0 +1,57 @@
+#include "../test/scheme_test.h"
+#include "catch.hpp"
+
+TEST_CASE("TryRunReturnsResults") {
+    Interpreter interpreter(0);
+    auto result = interpreter.TryRun("(define x 2) (* x 21)");
+    REQUIRE(result);
+    REQUIRE(result.value == "42");
+}
+
+TEST_CASE("TryRunReportsErrorKindAndOffset") {
+    Interpreter interpreter(0);
+    auto result = interpreter.TryRun("(define x 1)\n(+ x (car '()))");
+    REQUIRE(result.error == ErrorKind::RUNTIME);
+    REQUIRE(result.offset == 13);
+
+    result = interpreter.TryRun("(+ 1 2) (undefined-name 1)");
+    REQUIRE(result.error == ErrorKind::NAME);
+    REQUIRE(result.offset == 8);
+
+    // A syntax error anywhere rejects the whole program before it runs.
+    result = interpreter.TryRun("(define y 1) (+ y 2))");
+    REQUIRE(result.error == ErrorKind::SYNTAX);
+    REQUIRE(result.offset == 20);
+    REQUIRE(interpreter.TryRun("y").error == ErrorKind::NAME);
+
+    REQUIRE(interpreter.TryRun("").error == ErrorKind::SYNTAX);
+    REQUIRE(interpreter.TryRun("   ").offset == 3);
+    REQUIRE(std::string(ErrorName(ErrorKind::SYNTAX)) == "SyntaxError");
+}
+
+TEST_CASE("TryRunReportsLimits") {
+    Interpreter interpreter(0);
+    interpreter.SetLimits({.max_steps = 1000, .max_depth = 100});
+    interpreter.Run("(define (loop n) (if (= n 0) 0 (loop (- n 1))))");
+    REQUIRE(interpreter.TryRun("(loop 10000)").error == ErrorKind::LIMIT);
+    auto result = interpreter.TryRun("1 " + std::string(1000, '(') + std::string(1000, ')'));
+    REQUIRE(result.error == ErrorKind::LIMIT);
+    REQUIRE(result.offset == 102);
+    REQUIRE(interpreter.TryRun("(loop 10)").value == "0");
+}
+
+TEST_CASE("TryRunReportsFailedAllocations") {
+    Interpreter interpreter(0);
+    REQUIRE(interpreter.TryRun("(make-vector 99999999999999999)").error == ErrorKind::LIMIT);
+    REQUIRE(interpreter.TryRun("(make-vector 1000000000000)").error == ErrorKind::LIMIT);
+    REQUIRE_THROWS_AS(interpreter.Run("(make-vector 1000000000000)"), LimitError);
+    REQUIRE(interpreter.TryRun("(vector-length (make-vector 3))").value == "3");
+}
+
+TEST_CASE("RunThrowsWhatTryRunReturns") {
+    Interpreter interpreter(0);
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1"), SyntaxError);
+    REQUIRE_THROWS_AS(interpreter.Run("nope"), NameError);
+    REQUIRE_THROWS_AS(interpreter.Run("(car 1)"), RuntimeError);
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+}
@@ -25,6 +25,13 @@ TEST_CASE_METHOD(SchemeTest, "NotFunctionInvalidCall") {
     ExpectRuntimeError("(not #t #t)");
 }
 
+TEST_CASE_METHOD(SchemeTest, "NotEvaluatesItsArgumentOnce") {
+    ExpectNoError("(define n 0)");
+    ExpectNoError("(define (bump) (set! n (+ n 1)) #f)");
+    ExpectEq("(not (bump))", "#t");
+    ExpectEq("n", "1");
+}
+
 TEST_CASE_METHOD(SchemeTest, "AndSyntax") {
     // (and <test>)
     // The <test> expressions are evaluated from left to right, and the value of the first
@@ -0,0 +1,81 @@
+#include "../test/scheme_test.h"
+#include "../optimizer.h"
+
+auto ReadOptimized(const std::string& str) {
+    std::stringstream ss{str};
+    Tokenizer tokenizer{&ss};
+    return Optimize(Read(&tokenizer));
+}
+
+TEST_CASE("FoldsPureBuiltins") {
+    auto node = ReadOptimized("(+ 1 (* 2 3) (max 4 -5) (abs -6))");
+    REQUIRE(Is<Number>(node));
+    REQUIRE(As<Number>(node)->GetValue() == 17);
+
+    node = ReadOptimized("(not (< 1 2 3))");
+    REQUIRE(Is<Boolean>(node));
+    REQUIRE(!As<Boolean>(node)->GetValue());
+}
+
+TEST_CASE("KeepsFailingAndQuotedCalls") {
+    REQUIRE(Is<Cell>(ReadOptimized("(+ 1 #t)")));
+    REQUIRE(Is<Cell>(ReadOptimized("(abs 1 2)")));
+    REQUIRE(Is<Cell>(ReadOptimized("'(+ 1 2)")));
+}
+
+// Every call of list and cons must return fresh pairs, so only calls returning atoms are folded.
+TEST_CASE("KeepsAllocatingCalls") {
+    REQUIRE(Is<Cell>(ReadOptimized("(list 1 #t)")));
+    REQUIRE(Is<Cell>(ReadOptimized("(cons 1 2)")));
+    REQUIRE(Is<Cell>(ReadOptimized("(make-vector 2 0)")));
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListsOfConstantsAreFresh") {
+    ExpectNoError("(define (f) (list 1 2))");
+    ExpectNoError("(set-car! (f) 99)");
+    ExpectEq("(f)", "(1 2)");
+}
+
+TEST_CASE("PrunesConstantConditions") {
+    auto node = ReadOptimized("(if (= 1 1) (+ 1 1) (unknown))");
+    REQUIRE(Is<Number>(node));
+    REQUIRE(As<Number>(node)->GetValue() == 2);
+
+    node = ReadOptimized("(and 1 (> 2 3) (unknown))");
+    REQUIRE(Is<Boolean>(node));
+    REQUIRE(!As<Boolean>(node)->GetValue());
+
+    node = ReadOptimized("(or #f (unknown))");
+    REQUIRE(Is<Cell>(node));
+    REQUIRE(!As<Cell>(As<Cell>(node)->GetSecond())->GetSecond());
+}
+
+TEST_CASE("DoesNotFoldReboundNames") {
+    REQUIRE(Is<Cell>(ReadOptimized("(if (+ 1 2) (define + 0))")));
+    REQUIRE(Is<Cell>(ReadOptimized("(and (set! max 1) (max 1 2))")));
+}
+
+TEST_CASE_METHOD(SchemeTest, "BodiesSeeLaterRebinding") {
+    ExpectNoError("(define (g) (+ 1 2))");
+    ExpectNoError("(define h (lambda () (if (< 1 2) 1 2)))");
+    ExpectNoError("(define p (delay (* 2 3)))");
+    ExpectNoError("(define + -)");
+    ExpectNoError("(define < >)");
+    ExpectNoError("(define * max)");
+    ExpectEq("(g)", "-1");
+    ExpectEq("(h)", "2");
+    ExpectEq("(force p)", "3");
+}
+
+TEST_CASE_METHOD(SchemeTest, "FoldedResultsMatchEvaluation") {
+    ExpectEq("(list 1 (+ 1 1) 3)", "(1 2 3)");
+    ExpectEq("(list 1 (list 2 (list 3)) 4)", "(1 (2 (3)) 4)");
+    ExpectEq("(list 'a '(b c) (list 'd))", "(a (b c) (d))");
+    ExpectEq("(list #t (list))", "(#t ())");
+    ExpectEq("(list)", "()");
+    ExpectEq("(if #f 0)", "()");
+    ExpectEq("(if (< 1 2) '(1 2) 0)", "(1 2)");
+    ExpectEq("(and #t #t)", "#t");
+    ExpectEq("(or #f (+ 2 2))", "4");
+    ExpectRuntimeError("(if #t (abs 1 2))");
+}
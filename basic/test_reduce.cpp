@@ -0,0 +1,69 @@
+#include <catch.hpp>
+
+#include <random>
+
+#include "../reduce.h"
+#include "../test/scheme_test.h"
+
+TEST_CASE("ReductionsMatchScalar") {
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<int64_t> dist(-1'000'000, 1'000'000);
+    for (size_t size : {1, 3, 4, 5, 17, 1'000'000}) {
+        std::vector<int64_t> data(size);
+        for (auto& x : data) {
+            x = dist(gen);
+        }
+        int64_t sum = 0;
+        for (auto x : data) {
+            sum += x;
+        }
+        REQUIRE(SumNumbers(data.data(), size) == sum);
+        REQUIRE(MinNumber(data.data(), size) == *std::min_element(data.begin(), data.end()));
+        REQUIRE(MaxNumber(data.data(), size) == *std::max_element(data.begin(), data.end()));
+
+        std::sort(data.begin(), data.end());
+        REQUIRE(IsOrdered(data.data(), size, Order::LESS_EQUAL));
+        REQUIRE(IsOrdered(data.data(), size, Order::GREATER_EQUAL) == (data.front() == data.back()));
+        data.back() = data.front() - 1;
+        REQUIRE(IsOrdered(data.data(), size, Order::LESS_EQUAL) == (size == 1));
+    }
+}
+
+TEST_CASE("ReductionsDetectOverflow") {
+    std::vector<int64_t> data(9, INT64_MAX);
+    REQUIRE(!SumNumbers(data.data(), data.size()));
+    data.push_back(INT64_MIN);
+    data.insert(data.begin(), 8, INT64_MIN);
+    REQUIRE(SumNumbers(data.data(), data.size()) == -9);
+    REQUIRE(!MulNumbers(data.data(), 2));
+    data.push_back(0);
+    REQUIRE(MulNumbers(data.data(), data.size()) == 0);
+}
+
+TEST_CASE_METHOD(SchemeTest, "ApplyReductions") {
+    std::string list = "'(";
+    for (int i = 1; i <= 10000; ++i) {
+        list += std::to_string(i) + " ";
+    }
+    list += ")";
+    ExpectEq("(apply + " + list + ")", "50005000");
+    ExpectEq("(apply max " + list + ")", "10000");
+    ExpectEq("(apply < " + list + ")", "#t");
+    ExpectEq("(apply > " + list + ")", "#f");
+    ExpectEq("(apply list '(1 2))", "(1 2)");
+    ExpectRuntimeError("(apply + '(1 #t))");
+    ExpectRuntimeError("(* 100000 100000 100000 100000)");
+    ExpectRuntimeError("(/ 1 0)");
+    ExpectEq("(< 1 3 2)", "#f");
+}
+
+TEST_CASE_METHOD(SchemeTest, "LongListsAreFreedIteratively") {
+    std::string list = "'(";
+    for (int i = 0; i < 1000000; ++i) {
+        list += std::to_string(i) + " ";
+    }
+    list += ")";
+    ExpectEq("(apply + " + list + ")", "499999500000");
+    ExpectNoError("(define xs " + list + ")");
+    ExpectNoError("(define xs 0)");
+}
@@ -0,0 +1,54 @@
+#include "../test/scheme_test.h"
+
+TEST_CASE_METHOD(SchemeTest, "StringLiterals") {
+    ExpectEq("\"abc\"", "\"abc\"");
+    ExpectEq("\"\"", "\"\"");
+    ExpectEq("\"a \\\"b\\\" \\\\ c\"", "\"a \\\"b\\\" \\\\ c\"");
+    ExpectEq("\"tab\\there\\n\"", "\"tab\\there\\n\"");
+    ExpectEq("'(\"a\" b \"(c)\")", "(\"a\" b \"(c)\")");
+    ExpectEq("(string? \"abc\")", "#t");
+    ExpectEq("(string? 'abc)", "#f");
+
+    ExpectSyntaxError("\"abc");
+    ExpectSyntaxError("\"a\\qb\"");
+}
+
+TEST_CASE_METHOD(SchemeTest, "StringOperations") {
+    ExpectNoError("(define s \"hello, world\")");
+    ExpectEq("(string-length s)", "12");
+    ExpectEq("(string-length \"a\\nb\")", "3");
+    ExpectEq("(substring s 7)", "\"world\"");
+    ExpectEq("(substring s 0 5)", "\"hello\"");
+    ExpectEq("(substring s 5 5)", "\"\"");
+    ExpectEq("(string-append)", "\"\"");
+    ExpectEq("(string-append s \"!\" (substring s 0 1))", "\"hello, world!h\"");
+    ExpectEq("(string=? s \"hello, world\" (string-append \"hello,\" \" world\"))", "#t");
+    ExpectEq("(string=? s \"hello\")", "#f");
+    ExpectEq("(symbol->string (string->symbol \"a b\"))", "\"a b\"");
+    ExpectEq("(symbol->string 'abc)", "\"abc\"");
+    ExpectEq("(string-length (symbol->string 'long-symbol-name))", "16");
+
+    ExpectRuntimeError("(substring s 6 5)");
+    ExpectRuntimeError("(substring s 0 13)");
+    ExpectRuntimeError("(substring s -1)");
+    ExpectRuntimeError("(string-length 'abc)");
+    ExpectRuntimeError("(string-append \"a\" 1)");
+    ExpectRuntimeError("(string->symbol 'abc)");
+    ExpectRuntimeError("(symbol->string \"abc\")");
+}
+
+TEST_CASE("SubstringsShareTheBuffer") {
+    auto text = std::make_shared<String>("the quick brown fox jumps over the lazy dog");
+    REQUIRE(!text->IsInline());
+    String slice(*text, 4, 20);
+    REQUIRE(slice.GetView() == "quick brown fox jump");
+    REQUIRE(!slice.IsInline());
+    REQUIRE(slice.GetView().data() == text->GetView().data() + 4);
+
+    // Short slices are copied, so they do not keep a long buffer alive.
+    String word(*text, 4, 5);
+    REQUIRE(word.IsInline());
+    REQUIRE(word.GetView() == "quick");
+    REQUIRE(String("fifteen chars!!").IsInline());
+    REQUIRE(!String("sixteen chars!!!").IsInline());
+}
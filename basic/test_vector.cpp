@@ -0,0 +1,41 @@
+#include "../test/scheme_test.h"
+
+TEST_CASE_METHOD(SchemeTest, "VectorConstruction") {
+    ExpectEq("(vector 1 2 3)", "#(1 2 3)");
+    ExpectEq("(vector)", "#()");
+    ExpectEq("(make-vector 3)", "#(0 0 0)");
+    ExpectEq("(make-vector 2 #t)", "#(#t #t)");
+    ExpectEq("(list->vector '(1 2 3))", "#(1 2 3)");
+    ExpectEq("(vector->list (vector 1 2 3))", "(1 2 3)");
+
+    ExpectRuntimeError("(make-vector -1)");
+    ExpectRuntimeError("(list->vector '(1 . 2))");
+    ExpectRuntimeError("(vector->list '(1 2))");
+}
+
+TEST_CASE_METHOD(SchemeTest, "VectorAccess") {
+    ExpectNoError("(define v (make-vector 3 0))");
+    ExpectEq("(vector-length v)", "3");
+    ExpectNoError("(vector-set! v 1 5)");
+    ExpectEq("(vector-ref v 1)", "5");
+    ExpectEq("v", "#(0 5 0)");
+
+    ExpectRuntimeError("(vector-ref v 3)");
+    ExpectRuntimeError("(vector-ref v -1)");
+    ExpectRuntimeError("(vector-set! v 3 0)");
+    ExpectRuntimeError("(vector-length '(1 2))");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListRefWalksCells") {
+    ExpectEq("(list-ref '(1 (2 3) 4) 1)", "(2 3)");
+    ExpectEq("(list-tail '(1 2 3) 0)", "(1 2 3)");
+    ExpectRuntimeError("(list-ref '(1 2 . 3) 2)");
+
+    std::string list = "'(";
+    for (int i = 0; i < 10000; ++i) {
+        list += std::to_string(i) + " ";
+    }
+    list += ")";
+    ExpectEq("(list-ref " + list + " 9999)", "9999");
+    ExpectEq("(list-tail " + list + " 9999)", "(9999)");
+}
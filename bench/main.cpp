@@ -0,0 +1,276 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../printer.h"
+#include "../scheme.h"
+
+namespace {
+
+struct Options {
+    std::string filter;
+    double min_time = 0.5;
+    size_t repetitions = 3;
+    std::string out;
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations = 0;
+    double ns_per_op = 0;
+    double min_ns_per_op = 0;
+    // Tokens, elements or bytes processed per second, zero when not meaningful.
+    double items_per_second = 0;
+};
+
+// Keeps the compiler from dropping the work whose result is passed here.
+volatile size_t sink;
+
+class Bench {
+public:
+    Bench(const Options& options) : options_(options) {
+    }
+
+    // Times `run` in repeated samples of at least min_time / repetitions each. `items` is the
+    // amount of work one call does.
+    void Add(const std::string& name, double items, const std::function<size_t()>& run) {
+        if (name.find(options_.filter) == name.npos) {
+            return;
+        }
+        Result result{.name = name};
+        sink = run();
+        auto sample_time = options_.min_time / options_.repetitions;
+        double total_ns = 0;
+        for (size_t sample = 0; sample < options_.repetitions; ++sample) {
+            uint64_t iterations = 0;
+            auto start = std::chrono::steady_clock::now();
+            std::chrono::duration<double> elapsed{};
+            while (elapsed.count() < sample_time) {
+                sink = run();
+                ++iterations;
+                elapsed = std::chrono::steady_clock::now() - start;
+            }
+            auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+            auto ns_per_op = ns / iterations;
+            result.min_ns_per_op = sample ? std::min(result.min_ns_per_op, ns_per_op) : ns_per_op;
+            result.iterations += iterations;
+            total_ns += ns;
+        }
+        result.ns_per_op = total_ns / result.iterations;
+        result.items_per_second = items ? items * 1e9 / result.ns_per_op : 0;
+        std::fprintf(stderr, "%-28s %14.0f ns/op %14.0f items/s %10llu iterations\n",
+                     name.c_str(), result.ns_per_op, result.items_per_second,
+                     static_cast<unsigned long long>(result.iterations));
+        results_.push_back(result);
+    }
+
+    std::string ToJson() const {
+        std::string json = "{\n  \"context\": {\"compiler\": \"" __VERSION__ "\", \"jit\": ";
+#ifdef SCHEME_JIT
+        json += "true";
+#else
+        json += "false";
+#endif
+        json += ", \"min_time\": " + std::to_string(options_.min_time) +
+                ", \"repetitions\": " + std::to_string(options_.repetitions) +
+                "},\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const auto& result = results_[i];
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                          "%s\n    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.1f, "
+                          "\"min_ns_per_op\": %.1f, \"items_per_second\": %.1f}",
+                          i ? "," : "", result.name.c_str(),
+                          static_cast<unsigned long long>(result.iterations), result.ns_per_op,
+                          result.min_ns_per_op, result.items_per_second);
+            json += line;
+        }
+        return json + "\n  ]\n}\n";
+    }
+
+private:
+    Options options_;
+    std::vector<Result> results_;
+};
+
+std::string Repeat(std::string_view text, size_t count) {
+    std::string result;
+    result.reserve(text.size() * count);
+    for (size_t i = 0; i < count; ++i) {
+        result += text;
+    }
+    return result;
+}
+
+std::string NumberList(size_t size) {
+    std::string program = "(";
+    for (size_t i = 0; i < size; ++i) {
+        program += (i ? " " : "") + std::to_string(i);
+    }
+    return program + ")";
+}
+
+size_t CountTokens(const std::string& input) {
+    std::stringstream ss{input};
+    Tokenizer tokenizer{&ss};
+    size_t count = 0;
+    while (!tokenizer.IsEnd()) {
+        tokenizer.Next();
+        ++count;
+    }
+    return count;
+}
+
+size_t ReadAll(const std::string& input) {
+    std::stringstream ss{input};
+    Tokenizer tokenizer{&ss};
+    return Read(&tokenizer) != nullptr;
+}
+
+void AddTokenizer(Bench* bench) {
+    auto input = Repeat("(define (f x) (+ x 12 -7 'abc (g . h) #t))\n", 20000);
+    auto tokens = CountTokens(input);
+    bench->Add("tokenizer/next", tokens, [&] { return CountTokens(input); });
+}
+
+void AddReader(Bench* bench) {
+    const size_t depth = 10000;
+    auto deep = std::string(depth, '(') + "1" + std::string(depth, ')');
+    bench->Add("read/deep", depth, [&] { return ReadAll(deep); });
+    const size_t width = 100000;
+    auto wide = NumberList(width);
+    bench->Add("read/wide", width, [&] { return ReadAll(wide); });
+}
+
+void AddEvaluator(Bench* bench) {
+    Interpreter interpreter(0);
+    std::string fold = "(+";
+    for (int i = 0; i < 1000; ++i) {
+        fold += " " + std::to_string(i);
+    }
+    fold += ")";
+    bench->Add("eval/fold", 1000, [&] { return interpreter.Run(fold).size(); });
+    auto apply = "(apply + '" + NumberList(1000) + ")";
+    bench->Add("eval/apply", 1000, [&] { return interpreter.Run(apply).size(); });
+
+    interpreter.Run("(define l '" + NumberList(1000) + ")");
+    bench->Add("eval/list-ref", 0, [&] { return interpreter.Run("(list-ref l 999)").size(); });
+    bench->Add("eval/list-tail", 0, [&] { return interpreter.Run("(list-tail l 990)").size(); });
+
+    // The same lookup through an association list and through a hash table.
+    std::string pairs;
+    interpreter.Run("(define table (make-hash-table 1000))");
+    for (int i = 0; i < 1000; ++i) {
+        auto key = std::to_string(i);
+        pairs += "(" + key + " . " + key + ")";
+        interpreter.Run("(hash-table-set! table " + key + " " + key + ")");
+    }
+    interpreter.Run("(define alist '(" + pairs + "))");
+    bench->Add("eval/assoc", 0, [&] { return interpreter.Run("(assoc 999 alist)").size(); });
+    bench->Add("eval/hash-table-ref", 0,
+               [&] { return interpreter.Run("(hash-table-ref table 999)").size(); });
+
+    interpreter.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    bench->Add("eval/fib-20", 0, [&] { return interpreter.Run("(fib 20)").size(); });
+    interpreter.Run("(define (count n acc) (if (= n 0) acc (count (- n 1) (+ acc 1))))");
+    bench->Add("eval/loop-1000", 1000, [&] { return interpreter.Run("(count 1000 0)").size(); });
+
+    std::vector<std::string> requests(1000, "(+ 1 2)");
+    bench->Add("eval/batch-1000", requests.size(),
+               [&] { return interpreter.RunBatch(requests).size(); });
+}
+
+// Rejecting a malformed request should cost about as much as reading a valid one.
+void AddRejection(Bench* bench) {
+    Interpreter interpreter(0);
+    std::string valid = "(list 1 2 (quote (3 4)) 5)";
+    std::string malformed = "(list 1 2 (quote (3 4)) 5))";
+    bench->Add("reject/accept", 0, [&] { return interpreter.TryRun(valid).value.size(); });
+    bench->Add("reject/try-run", 0, [&] {
+        return static_cast<size_t>(interpreter.TryRun(malformed).error);
+    });
+    bench->Add("reject/run", 0, [&] {
+        try {
+            return interpreter.Run(malformed).size();
+        } catch (const SyntaxError&) {
+            return size_t{0};
+        }
+    });
+}
+
+void AddPrinter(Bench* bench) {
+    const size_t size = 100000;
+    std::shared_ptr<Object> flat;
+    for (size_t i = 0; i < size; ++i) {
+        flat = std::make_shared<Cell>(std::make_shared<Number>(i), flat);
+    }
+    bench->Add("print/flat", size, [&] {
+        std::string out;
+        Print(flat, &out);
+        return out.size();
+    });
+    std::shared_ptr<Object> tree = std::make_shared<Number>(1);
+    for (int i = 0; i < 16; ++i) {
+        tree = std::make_shared<Cell>(tree, std::make_shared<Cell>(tree, nullptr));
+    }
+    bench->Add("print/shared-tree", 0, [&] {
+        std::string out;
+        Print(tree, &out);
+        return out.size();
+    });
+}
+
+void PrintUsage() {
+    std::cerr << "usage: bench_scheme [--filter substring] [--min-time seconds]\n"
+                 "                    [--repetitions n] [--out file.json]\n"
+                 "  writes the results as JSON to stdout or to the file\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (i + 1 == argc) {
+            PrintUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--filter") {
+                options.filter = value;
+            } else if (arg == "--min-time") {
+                options.min_time = std::stod(value);
+            } else if (arg == "--repetitions") {
+                options.repetitions = std::max<size_t>(std::stoul(value), 1);
+            } else if (arg == "--out") {
+                options.out = value;
+            } else {
+                PrintUsage();
+                return 2;
+            }
+        } catch (const std::logic_error&) {
+            PrintUsage();
+            return 2;
+        }
+    }
+    Bench bench(options);
+    AddTokenizer(&bench);
+    AddReader(&bench);
+    AddEvaluator(&bench);
+    AddRejection(&bench);
+    AddPrinter(&bench);
+    if (options.out.empty()) {
+        std::cout << bench.ToJson();
+    } else {
+        std::ofstream(options.out) << bench.ToJson();
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "budget.h"
+
+#include <algorithm>
+
+thread_local constinit Budget budget;
+
+namespace {
+
+// Threads sharing an account settle with it at least this often, so that together they
+// overrun the fuel by at most this many steps each.
+constexpr int64_t kSharedWindow = 4096;
+
+std::atomic<int64_t>* GetAccount() {
+    return budget.account ? budget.account->get() : nullptr;
+}
+
+}  // namespace
+
+void SettleBudget() {
+    auto used = budget.window - budget.steps_left;
+    if (auto account = GetAccount()) {
+        budget.fuel = account->fetch_sub(used, std::memory_order_relaxed) - used;
+    } else if (budget.fuel != Budget::kUnlimited) {
+        budget.fuel -= used;
+    }
+    budget.quantum_left -= used;
+    budget.sample_left -= used;
+    budget.window = budget.steps_left;
+}
+
+void RefillBudget() {
+    auto window = std::max<int64_t>(budget.fuel, 0);
+    if (GetAccount()) {
+        window = std::min(window, kSharedWindow);
+    }
+    if (budget.quantum) {
+        window = std::min(window, std::max<int64_t>(budget.quantum_left, 0));
+    }
+    if (budget.sample_interval) {
+        window = std::min(window, std::max<int64_t>(budget.sample_left, 0));
+    }
+    budget.steps_left = budget.window = window;
+}
+
+void OnBudgetExhausted() {
+    SettleBudget();
+    if (budget.fuel < 0) {
+        throw LimitError();
+    }
+    if (budget.sample_interval && budget.sample_left <= 0) {
+        budget.sample_left = budget.sample_interval;
+        TakeSample();
+    }
+    if (budget.quantum && budget.quantum_left <= 0) {
+        budget.quantum_left = budget.quantum;
+        YieldTask();
+    }
+    RefillBudget();
+}
+
+BudgetGuard::BudgetGuard(const Limits& limits)
+    : saved_fuel_(budget.fuel),
+      saved_max_depth_(budget.max_depth),
+      saved_account_(budget.account) {
+    SettleBudget();
+    budget.fuel = limits.max_steps ? static_cast<int64_t>(limits.max_steps) : Budget::kUnlimited;
+    budget.max_depth = limits.max_depth ? budget.depth + limits.max_depth
+                                        : std::numeric_limits<size_t>::max();
+    budget.account = &account_;
+    RefillBudget();
+}
+
+BudgetGuard::~BudgetGuard() {
+    SettleBudget();
+    budget.fuel = saved_fuel_;
+    budget.max_depth = saved_max_depth_;
+    budget.account = saved_account_;
+    RefillBudget();
+}
+
+BudgetShare ShareBudget() {
+    BudgetShare share;
+    SettleBudget();
+    if (budget.account && !*budget.account && budget.fuel != Budget::kUnlimited) {
+        *budget.account = std::make_shared<std::atomic<int64_t>>(budget.fuel);
+    }
+    RefillBudget();
+    if (budget.account) {
+        share.account = *budget.account;
+    }
+    if (budget.max_depth != std::numeric_limits<size_t>::max()) {
+        share.depth_left = budget.max_depth - std::min(budget.depth, budget.max_depth);
+    }
+    return share;
+}
+
+TaskBudgetGuard::TaskBudgetGuard(BudgetShare share)
+    : saved_fuel_(budget.fuel),
+      saved_max_depth_(budget.max_depth),
+      saved_account_(budget.account),
+      account_(std::move(share.account)) {
+    SettleBudget();
+    budget.fuel = account_ ? account_->load(std::memory_order_relaxed) : Budget::kUnlimited;
+    budget.max_depth = share.depth_left == std::numeric_limits<size_t>::max()
+                           ? share.depth_left
+                           : budget.depth + share.depth_left;
+    budget.account = &account_;
+    RefillBudget();
+}
+
+TaskBudgetGuard::~TaskBudgetGuard() {
+    SettleBudget();
+    budget.fuel = saved_fuel_;
+    budget.max_depth = saved_max_depth_;
+    budget.account = saved_account_;
+    RefillBudget();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "error.h"
+
+// Limits of a single Interpreter::Run. Zero means unlimited.
+struct Limits {
+    uint64_t max_steps = 0;
+    size_t max_heap_bytes = 0;
+    size_t max_depth = 0;
+};
+
+// Accounting of the program running on this thread. The evaluator counts steps and depth
+// inline; OnBudgetExhausted decides whether the program is out of fuel, has to yield to the
+// scheduler or is due for a sample of its call stack. Every procedure application counts as a
+// step.
+struct Budget {
+    static constexpr int64_t kUnlimited = std::numeric_limits<int64_t>::max();
+
+    // Steps left before the next call to OnBudgetExhausted.
+    int64_t steps_left = kUnlimited;
+    // Value of steps_left when it was last refilled.
+    int64_t window = kUnlimited;
+    // Steps left in the run, negative once they are exceeded. Unlimited fuel is never charged.
+    int64_t fuel = kUnlimited;
+    // Once the run hands tasks to the pool, its fuel lives in an account shared with them, owned
+    // by the guard that set up the budget. Empty until then.
+    std::shared_ptr<std::atomic<int64_t>>* account = nullptr;
+    // Steps between two yields, zero outside the scheduler.
+    int64_t quantum = 0;
+    int64_t quantum_left = 0;
+    // Steps between two samples, zero when not sampling.
+    int64_t sample_interval = 0;
+    int64_t sample_left = 0;
+    size_t depth = 0;
+    size_t max_depth = std::numeric_limits<size_t>::max();
+};
+
+extern thread_local constinit Budget budget;
+
+// Throws LimitError when the fuel is used up, samples when a sampling interval is and yields
+// when a scheduler quantum is.
+void OnBudgetExhausted();
+
+// Charges the steps taken since the last refill to the fuel, quantum and sampling interval.
+void SettleBudget();
+
+// Hands out steps up to whichever of them runs out first.
+void RefillBudget();
+
+// Defined by the scheduler; returns immediately outside of a scheduled task.
+void YieldTask();
+
+// Defined by the sampler; records the call stack of the running program.
+void TakeSample();
+
+inline void CountStep() {
+    if (--budget.steps_left < 0) [[unlikely]] {
+        OnBudgetExhausted();
+    }
+}
+
+// Counts one level of evaluation or reader nesting.
+class DepthGuard {
+public:
+    DepthGuard() {
+        if (++budget.depth > budget.max_depth) [[unlikely]] {
+            --budget.depth;
+            throw LimitError();
+        }
+    }
+
+    ~DepthGuard() {
+        --budget.depth;
+    }
+};
+
+// Applies the limits for the duration of a run and restores the outer budget afterwards.
+class BudgetGuard {
+public:
+    BudgetGuard(const Limits& limits);
+
+    ~BudgetGuard();
+
+private:
+    int64_t saved_fuel_;
+    size_t saved_max_depth_;
+    std::shared_ptr<std::atomic<int64_t>>* saved_account_;
+    std::shared_ptr<std::atomic<int64_t>> account_;
+};
+
+// What a task handed to the pool inherits from the program that submitted it: the fuel
+// account, so the steps of the task are charged to the run, and the depth left below the point
+// of submission.
+struct BudgetShare {
+    std::shared_ptr<std::atomic<int64_t>> account;
+    size_t depth_left = std::numeric_limits<size_t>::max();
+};
+
+// Called on the submitting thread; opens the shared account on first use.
+BudgetShare ShareBudget();
+
+// Runs a task on the budget shared with it and restores the budget of the thread afterwards.
+class TaskBudgetGuard {
+public:
+    TaskBudgetGuard(BudgetShare share);
+
+    ~TaskBudgetGuard();
+
+private:
+    int64_t saved_fuel_;
+    size_t saved_max_depth_;
+    std::shared_ptr<std::atomic<int64_t>>* saved_account_;
+    std::shared_ptr<std::atomic<int64_t>> account_;
+};
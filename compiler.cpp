@@ -0,0 +1,430 @@
+#include "compiler.h"
+#include "budget.h"
+
+#ifdef SCHEME_JIT
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+struct Value {
+    enum class Kind { NUMBER, BOOLEAN, TAIL_CALL };
+
+    Kind kind;
+    int64_t number;
+};
+
+struct Frame {
+    std::vector<Value> args;
+    // Arguments of a pending self tail call.
+    std::vector<Value> next;
+};
+
+using Code = std::function<Value(Frame*)>;
+
+class CompiledLambda {
+public:
+    Value Run(std::vector<Value> args) const {
+        DepthGuard depth_guard;
+        Frame frame{std::move(args), {}};
+        while (true) {
+            CountStep();
+            // Builtins inlined into the code are not counted one by one.
+            ++eval_counters.calls[0];
+            auto result = body_(&frame);
+            if (result.kind != Value::Kind::TAIL_CALL) {
+                return result;
+            }
+            std::swap(frame.args, frame.next);
+        }
+    }
+
+    bool GuardsHold() const {
+        for (const auto& [binding, value] : guards_) {
+            if (binding->value.get() != value) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void SetBody(Code body) {
+        body_ = std::move(body);
+    }
+
+    void AddGuard(Binding* binding) {
+        guards_.emplace_back(binding, binding->value.get());
+    }
+
+private:
+    Code body_;
+    std::vector<std::pair<Binding*, Object*>> guards_;
+};
+
+namespace {
+
+std::atomic<uint32_t> jit_threshold = 100;
+std::atomic<bool> jit_differential = false;
+// Set while the interpreter computes the reference result in differential mode.
+thread_local bool jit_suspended = false;
+
+constexpr uint32_t kMaxDeopts = 4;
+
+// Thrown by compiled code when a value does not match what the code was specialized for.
+struct Deopt {};
+
+// Thrown by the compiler for forms outside of the supported subset.
+struct Unsupported {};
+
+Value MakeNumber(int64_t number) {
+    return {Value::Kind::NUMBER, number};
+}
+
+Value MakeBoolean(bool value) {
+    return {Value::Kind::BOOLEAN, value};
+}
+
+int64_t GetNumber(const Value& value) {
+    if (value.kind != Value::Kind::NUMBER) {
+        throw Deopt();
+    }
+    return value.number;
+}
+
+bool IsFalse(const Value& value) {
+    return value.kind == Value::Kind::BOOLEAN && !value.number;
+}
+
+template <class F>
+Code Reduce(std::vector<Code> args, F f) {
+    return [args = std::move(args), f](Frame* frame) {
+        int64_t result = GetNumber(args[0](frame));
+        for (size_t i = 1; i < args.size(); ++i) {
+            result = f(result, GetNumber(args[i](frame)));
+        }
+        return MakeNumber(result);
+    };
+}
+
+template <class F>
+Code Compare(std::vector<Code> args, F f) {
+    return [args = std::move(args), f](Frame* frame) {
+        std::vector<int64_t> values;
+        for (const auto& arg : args) {
+            values.push_back(GetNumber(arg(frame)));
+        }
+        for (size_t i = 1; i < values.size(); ++i) {
+            if (!f(values[i - 1], values[i])) {
+                return MakeBoolean(false);
+            }
+        }
+        return MakeBoolean(true);
+    };
+}
+
+bool IsComparison(const std::shared_ptr<Object>& function) {
+    return Is<Equ>(function) || Is<Les>(function) || Is<Gre>(function) || Is<Loe>(function) ||
+           Is<Goe>(function);
+}
+
+class Compiler {
+public:
+    Compiler(Closure* closure, CompiledLambda* target) : closure_(closure), target_(target) {
+    }
+
+    Code Compile(const std::shared_ptr<Object>& expr, bool tail) {
+        if (Is<Number>(expr)) {
+            return [value = As<Number>(expr)->GetValue()](Frame*) { return MakeNumber(value); };
+        } else if (Is<Symbol>(expr)) {
+            return CompileSymbol(As<Symbol>(expr)->GetName());
+        } else if (Is<Cell>(expr)) {
+            return CompileCall(As<Cell>(expr), tail);
+        } else {
+            throw Unsupported();
+        }
+    }
+
+private:
+    int FindParam(const std::string& name) const {
+        const auto& params = closure_->GetParams();
+        for (size_t i = 0; i < params.size(); ++i) {
+            if (params[i] == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    Code CompileSymbol(const std::string& name) {
+        if (auto index = FindParam(name); index >= 0) {
+            return [index](Frame* frame) { return frame->args[index]; };
+        } else if (name == "#t" || name == "#f") {
+            return [value = name == "#t"](Frame*) { return MakeBoolean(value); };
+        } else {
+            throw Unsupported();
+        }
+    }
+
+    std::vector<Code> CompileArgs(const std::vector<std::shared_ptr<Object>>& args) {
+        std::vector<Code> result;
+        for (const auto& arg : args) {
+            result.push_back(Compile(arg, false));
+        }
+        return result;
+    }
+
+    Code CompileCall(const std::shared_ptr<Cell>& cell, bool tail) {
+        if (!Is<Symbol>(cell->GetFirst())) {
+            throw Unsupported();
+        }
+        const auto& name = As<Symbol>(cell->GetFirst())->GetName();
+        if (FindParam(name) >= 0 || (closure_->GetScope() && closure_->GetScope()->Find(name))) {
+            throw Unsupported();
+        }
+        auto binding = FindBinding(name);
+        if (!binding) {
+            throw Unsupported();
+        }
+        target_->AddGuard(binding);
+        auto function = binding->value;
+
+        std::vector<std::shared_ptr<Object>> args;
+        try {
+            args = ToArgs(cell->GetSecond());
+        } catch (const SyntaxError&) {
+            throw Unsupported();
+        }
+        for (const auto& arg : args) {
+            if (!arg) {
+                throw Unsupported();
+            }
+        }
+
+        if (function.get() == closure_) {
+            return CompileSelfCall(CompileArgs(args), tail);
+        } else if (Is<If>(function)) {
+            return CompileIf(args, tail);
+        } else if (Is<Not>(function) && args.size() == 1) {
+            return [arg = Compile(args[0], false)](Frame* frame) {
+                return MakeBoolean(IsFalse(arg(frame)));
+            };
+        }
+        return CompileArithmetic(function, CompileArgs(args));
+    }
+
+    Code CompileSelfCall(std::vector<Code> args, bool tail) {
+        if (args.size() != closure_->GetParams().size()) {
+            throw Unsupported();
+        }
+        if (tail) {
+            return [args = std::move(args)](Frame* frame) {
+                frame->next.resize(args.size());
+                for (size_t i = 0; i < args.size(); ++i) {
+                    frame->next[i] = args[i](frame);
+                }
+                return Value{Value::Kind::TAIL_CALL, 0};
+            };
+        }
+        return [args = std::move(args), target = target_](Frame* frame) {
+            std::vector<Value> values;
+            for (const auto& arg : args) {
+                values.push_back(arg(frame));
+            }
+            return target->Run(std::move(values));
+        };
+    }
+
+    Code CompileIf(const std::vector<std::shared_ptr<Object>>& args, bool tail) {
+        if (args.size() < 2 || args.size() > 3) {
+            throw Unsupported();
+        }
+        auto condition = Compile(args[0], false);
+        auto then_branch = Compile(args[1], tail);
+        Code else_branch;
+        if (args.size() == 3) {
+            else_branch = Compile(args[2], tail);
+        }
+        return [condition, then_branch, else_branch](Frame* frame) {
+            if (!IsFalse(condition(frame))) {
+                return then_branch(frame);
+            } else if (else_branch) {
+                return else_branch(frame);
+            } else {
+                throw Deopt();
+            }
+        };
+    }
+
+    Code CompileArithmetic(const std::shared_ptr<Object>& function, std::vector<Code> args) {
+        auto add = [](int64_t x, int64_t y) {
+            int64_t result;
+            if (__builtin_add_overflow(x, y, &result)) {
+                throw Deopt();
+            }
+            return result;
+        };
+        auto sub = [](int64_t x, int64_t y) {
+            int64_t result;
+            if (__builtin_sub_overflow(x, y, &result)) {
+                throw Deopt();
+            }
+            return result;
+        };
+        auto mul = [](int64_t x, int64_t y) {
+            int64_t result;
+            if (__builtin_mul_overflow(x, y, &result)) {
+                throw Deopt();
+            }
+            return result;
+        };
+
+        if (Is<Sum>(function) || Is<Mul>(function)) {
+            if (args.empty()) {
+                return [value = Is<Sum>(function) ? 0 : 1](Frame*) { return MakeNumber(value); };
+            }
+            return Is<Sum>(function) ? Reduce(std::move(args), add)
+                                     : Reduce(std::move(args), mul);
+        } else if (Is<Sub>(function) && !args.empty()) {
+            if (args.size() == 1) {
+                args.insert(args.begin(), [](Frame*) { return MakeNumber(0); });
+            }
+            return Reduce(std::move(args), sub);
+        } else if (Is<Min>(function) && !args.empty()) {
+            return Reduce(std::move(args), [](int64_t x, int64_t y) { return std::min(x, y); });
+        } else if (Is<Max>(function) && !args.empty()) {
+            return Reduce(std::move(args), [](int64_t x, int64_t y) { return std::max(x, y); });
+        } else if (Is<Abs>(function) && args.size() == 1) {
+            return [arg = args[0]](Frame* frame) {
+                auto value = GetNumber(arg(frame));
+                if (value == INT64_MIN) {
+                    throw Deopt();
+                }
+                return MakeNumber(std::abs(value));
+            };
+        } else if (args.size() == 1 || !IsComparison(function)) {
+            throw Unsupported();
+        } else if (args.empty()) {
+            return [](Frame*) { return MakeBoolean(true); };
+        } else if (Is<Equ>(function)) {
+            return Compare(std::move(args), std::equal_to<int64_t>());
+        } else if (Is<Les>(function)) {
+            return Compare(std::move(args), std::less<int64_t>());
+        } else if (Is<Gre>(function)) {
+            return Compare(std::move(args), std::greater<int64_t>());
+        } else if (Is<Loe>(function)) {
+            return Compare(std::move(args), std::less_equal<int64_t>());
+        } else {
+            return Compare(std::move(args), std::greater_equal<int64_t>());
+        }
+    }
+
+    Closure* closure_;
+    CompiledLambda* target_;
+};
+
+std::shared_ptr<CompiledLambda> Compile(Closure* closure) {
+    if (closure->GetBody().size() != 1) {
+        return nullptr;
+    }
+    auto code = std::make_shared<CompiledLambda>();
+    try {
+        code->SetBody(Compiler(closure, code.get()).Compile(closure->GetBody()[0], true));
+    } catch (const Unsupported&) {
+        return nullptr;
+    }
+    return code;
+}
+
+std::shared_ptr<Object> ToObject(const Value& value) {
+    if (value.kind == Value::Kind::NUMBER) {
+        return Make<Number>(value.number);
+    } else {
+        return Make<Boolean>(value.number);
+    }
+}
+
+void CheckAgainstInterpreter(Closure* closure, const std::vector<std::shared_ptr<Object>>& args,
+                             const Value& compiled) {
+    JitSuspension suspension;
+    auto expected = closure->Interpret(args);
+    bool same = false;
+    if (compiled.kind == Value::Kind::NUMBER) {
+        same = Is<Number>(expected) && As<Number>(expected)->GetValue() == compiled.number;
+    } else {
+        same = Is<Boolean>(expected) && As<Boolean>(expected)->GetValue() == compiled.number;
+    }
+    if (!same) {
+        throw std::logic_error("compiled closure disagrees with the interpreter");
+    }
+}
+
+}  // namespace
+
+JitSuspension::JitSuspension() : saved_(std::exchange(jit_suspended, true)) {
+}
+
+JitSuspension::~JitSuspension() {
+    jit_suspended = saved_;
+}
+
+void SetJitThreshold(uint32_t calls) {
+    jit_threshold = calls;
+}
+
+void SetJitDifferential(bool enabled) {
+    jit_differential = enabled;
+}
+
+std::shared_ptr<Object> RunCompiled(Closure* closure,
+                                    const std::vector<std::shared_ptr<Object>>& args) {
+    if (jit_suspended) {
+        return nullptr;
+    }
+    auto& state = closure->GetJitState();
+    if (!state.code) {
+        if (state.failed || ++state.calls <= (jit_differential ? 0 : jit_threshold.load())) {
+            return nullptr;
+        }
+        state.code = Compile(closure);
+        if (!state.code) {
+            state.failed = true;
+            return nullptr;
+        }
+    }
+    if (!state.code->GuardsHold()) {
+        state.code.reset();
+        state.calls = 0;
+        return nullptr;
+    }
+
+    std::vector<Value> values;
+    for (const auto& arg : args) {
+        if (Is<Number>(arg)) {
+            values.push_back(MakeNumber(As<Number>(arg)->GetValue()));
+        } else if (Is<Boolean>(arg)) {
+            values.push_back(MakeBoolean(As<Boolean>(arg)->GetValue()));
+        } else {
+            return nullptr;
+        }
+    }
+
+    Value result;
+    try {
+        result = state.code->Run(std::move(values));
+    } catch (const Deopt&) {
+        if (++state.deopts >= kMaxDeopts) {
+            state.code.reset();
+            state.failed = true;
+        }
+        return nullptr;
+    }
+    if (jit_differential) {
+        CheckAgainstInterpreter(closure, args, result);
+    }
+    return ToObject(result);
+}
+
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "object.h"
+
+// Tier-up for hot closures. Once a closure has been called more than the threshold number of
+// times, its body is compiled into threaded code over fixnums and booleans. Any failed guard
+// falls back to the interpreter. The settings below are shared by all interpreters.
+
+void SetJitThreshold(uint32_t calls);
+
+// Compiles every closure on its first call and checks each compiled result against the
+// interpreter.
+void SetJitDifferential(bool enabled);
+
+// Runs every closure on the interpreter while alive, on the thread that created it.
+class JitSuspension {
+public:
+    JitSuspension();
+
+    ~JitSuspension();
+
+private:
+    bool saved_;
+};
+
+// Returns nullptr when the call has to be interpreted.
+std::shared_ptr<Object> RunCompiled(Closure* closure,
+                                    const std::vector<std::shared_ptr<Object>>& args);
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 struct SyntaxError : public std::runtime_error {
     SyntaxError() : std::runtime_error("SyntaxError") {
@@ -22,3 +26,84 @@ struct RuntimeError : public std::runtime_error {
 
     using std::runtime_error::runtime_error;
 };
+
+struct LimitError : public std::runtime_error {
+    LimitError() : std::runtime_error("LimitError") {
+    }
+
+    using std::runtime_error::runtime_error;
+};
+
+enum class ErrorKind { NONE, SYNTAX, NAME, RUNTIME, LIMIT };
+
+inline const char* ErrorName(ErrorKind kind) {
+    switch (kind) {
+        case ErrorKind::NONE:
+            return "OK";
+        case ErrorKind::SYNTAX:
+            return "SyntaxError";
+        case ErrorKind::NAME:
+            return "NameError";
+        case ErrorKind::RUNTIME:
+            return "RuntimeError";
+        case ErrorKind::LIMIT:
+            return "LimitError";
+    }
+    return "RuntimeError";
+}
+
+[[noreturn]] inline void ThrowError(ErrorKind kind) {
+    switch (kind) {
+        case ErrorKind::SYNTAX:
+            throw SyntaxError();
+        case ErrorKind::NAME:
+            throw NameError();
+        case ErrorKind::LIMIT:
+            throw LimitError();
+        default:
+            throw RuntimeError();
+    }
+}
+
+// Kind of an error thrown by the interpreter, NONE for any other exception. A program asking
+// for more memory than there is hit a limit; one asking for a container larger than any can be
+// made the wrong arguments.
+inline ErrorKind GetErrorKind(const std::exception& error) {
+    if (dynamic_cast<const SyntaxError*>(&error)) {
+        return ErrorKind::SYNTAX;
+    } else if (dynamic_cast<const NameError*>(&error)) {
+        return ErrorKind::NAME;
+    } else if (dynamic_cast<const RuntimeError*>(&error)) {
+        return ErrorKind::RUNTIME;
+    } else if (dynamic_cast<const LimitError*>(&error) ||
+               dynamic_cast<const std::bad_alloc*>(&error)) {
+        return ErrorKind::LIMIT;
+    } else if (dynamic_cast<const std::length_error*>(&error)) {
+        return ErrorKind::RUNTIME;
+    }
+    return ErrorKind::NONE;
+}
+
+// Outcome of the non-throwing API: the kind of error, if any, and the offset in the source
+// where it was found.
+struct Status {
+    ErrorKind error = ErrorKind::NONE;
+    size_t offset = 0;
+
+    explicit operator bool() const {
+        return error == ErrorKind::NONE;
+    }
+};
+
+template <class T>
+struct Result : Status {
+    template <class U>
+        requires std::is_convertible_v<U, T>
+    Result(U&& value) : value(std::forward<U>(value)) {
+    }
+
+    Result(Status status) : Status(status) {
+    }
+
+    T value{};
+};
@@ -0,0 +1,200 @@
+#include "hashtable.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr size_t kMinCapacity = 8;
+// Larger hints are taken for mistakes rather than allocated.
+constexpr int64_t kMaxExpected = int64_t{1} << 40;
+
+// Numbers, symbols and strings, the usual keys, skip the structural walk. The multiplication
+// spreads every bit of the key into the top ones, which pick the slot.
+uint64_t HashKey(const std::shared_ptr<Object>& key) {
+    uint64_t hash;
+    if (auto number = dynamic_cast<Number*>(key.get())) {
+        hash = number->GetValue();
+    } else if (auto symbol = dynamic_cast<Symbol*>(key.get())) {
+        hash = std::hash<std::string>()(symbol->GetName());
+    } else if (auto string = dynamic_cast<String*>(key.get())) {
+        hash = std::hash<std::string_view>()(string->GetView());
+    } else {
+        hash = StructuralHash(key);
+    }
+    return (hash * 0x9e3779b97f4a7c15) | 1;
+}
+
+bool KeysEqual(const std::shared_ptr<Object>& lhs, const std::shared_ptr<Object>& rhs) {
+    auto left = dynamic_cast<Number*>(lhs.get());
+    auto right = dynamic_cast<Number*>(rhs.get());
+    if (left && right) {
+        return left->GetValue() == right->GetValue();
+    }
+    return StructuralEqual(lhs, rhs);
+}
+
+std::shared_ptr<HashTable> GetTable(const std::shared_ptr<Object>& obj) {
+    if (!Is<HashTable>(obj)) {
+        throw RuntimeError();
+    }
+    return As<HashTable>(obj);
+}
+
+}  // namespace
+
+HashTable::HashTable(size_t expected)
+    : hashes_(HeapAllocator<uint64_t>(current_heap, "hash table buffer")),
+      entries_(HeapAllocator<Entry>(current_heap, "hash table buffer")) {
+    if (expected) {
+        Resize(std::bit_ceil(std::max(kMinCapacity, expected + expected / 3 + 1)));
+    }
+}
+
+std::shared_ptr<Object>* HashTable::Find(const std::shared_ptr<Object>& key) {
+    if (!size_) {
+        return nullptr;
+    }
+    auto slot = Probe(HashKey(key), key);
+    return hashes_[slot] ? &entries_[slot].value : nullptr;
+}
+
+void HashTable::Set(const std::shared_ptr<Object>& key, std::shared_ptr<Object> value) {
+    if ((size_ + 1) * 4 > hashes_.size() * 3) {
+        Resize(std::max(kMinCapacity, hashes_.size() * 2));
+    }
+    auto hash = HashKey(key);
+    auto slot = Probe(hash, key);
+    if (!hashes_[slot]) {
+        hashes_[slot] = hash;
+        entries_[slot].key = key;
+        ++size_;
+    }
+    entries_[slot].value = std::move(value);
+}
+
+bool HashTable::Erase(const std::shared_ptr<Object>& key) {
+    if (!size_) {
+        return false;
+    }
+    auto hole = Probe(HashKey(key), key);
+    if (!hashes_[hole]) {
+        return false;
+    }
+    // Moves back every entry of the run after the hole that may live in it, that is whose home
+    // slot is not between the hole and the entry.
+    size_t mask = hashes_.size() - 1;
+    for (auto next = (hole + 1) & mask; hashes_[next]; next = (next + 1) & mask) {
+        size_t home = hashes_[next] >> shift_;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            hashes_[hole] = hashes_[next];
+            entries_[hole] = std::move(entries_[next]);
+            hole = next;
+        }
+    }
+    hashes_[hole] = 0;
+    entries_[hole] = {};
+    --size_;
+    return true;
+}
+
+std::vector<std::pair<std::shared_ptr<Object>, std::shared_ptr<Object>>> HashTable::GetEntries()
+    const {
+    std::vector<std::pair<std::shared_ptr<Object>, std::shared_ptr<Object>>> result;
+    result.reserve(size_);
+    for (size_t slot = 0; slot < hashes_.size(); ++slot) {
+        if (hashes_[slot]) {
+            result.emplace_back(entries_[slot].key, entries_[slot].value);
+        }
+    }
+    return result;
+}
+
+size_t HashTable::Probe(uint64_t hash, const std::shared_ptr<Object>& key) const {
+    size_t mask = hashes_.size() - 1;
+    for (size_t slot = hash >> shift_;; slot = (slot + 1) & mask) {
+        if (!hashes_[slot] || (hashes_[slot] == hash && KeysEqual(entries_[slot].key, key))) {
+            return slot;
+        }
+    }
+}
+
+// Both arrays are allocated before anything moves, so running out of heap leaves the table as
+// it was.
+void HashTable::Resize(size_t capacity) {
+    decltype(hashes_) hashes(capacity, 0, hashes_.get_allocator());
+    decltype(entries_) entries(capacity, entries_.get_allocator());
+    int shift = 64 - std::countr_zero(capacity);
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < hashes_.size(); ++i) {
+        if (hashes_[i]) {
+            size_t slot = hashes_[i] >> shift;
+            while (hashes[slot]) {
+                slot = (slot + 1) & mask;
+            }
+            hashes[slot] = hashes_[i];
+            entries[slot] = std::move(entries_[i]);
+        }
+    }
+    hashes_.swap(hashes);
+    entries_.swap(entries);
+    shift_ = shift;
+}
+
+std::shared_ptr<Object> MakeHashTable::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() > 1) {
+        throw RuntimeError();
+    }
+    int64_t expected = 0;
+    if (!args.empty()) {
+        if (!Is<Number>(args[0]) || As<Number>(args[0])->GetValue() < 0 ||
+            As<Number>(args[0])->GetValue() > kMaxExpected) {
+            throw RuntimeError();
+        }
+        expected = As<Number>(args[0])->GetValue();
+    }
+    return Make<HashTable>(expected);
+}
+
+std::shared_ptr<Object> HashTableSet::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 3) {
+        throw RuntimeError();
+    }
+    GetTable(args[0])->Set(args[1], args[2]);
+    return nullptr;
+}
+
+std::shared_ptr<Object> HashTableRef::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() < 2 || args.size() > 3) {
+        throw RuntimeError();
+    }
+    if (auto value = GetTable(args[0])->Find(args[1])) {
+        return *value;
+    } else if (args.size() == 3) {
+        return args[2];
+    }
+    throw RuntimeError();
+}
+
+std::shared_ptr<Object> HashTableDelete::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 2) {
+        throw RuntimeError();
+    }
+    GetTable(args[0])->Erase(args[1]);
+    return nullptr;
+}
+
+std::shared_ptr<Object> HashTableCount::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    return Make<Number>(GetTable(args[0])->GetSize());
+}
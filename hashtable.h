@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "heap.h"
+#include "object.h"
+
+// Mutable map with keys compared as equal? does. Open addressing with linear probing: the
+// hashes are kept apart from the entries, so a probe scans a dense array of words and touches
+// an entry only when its hash matches. Deleting shifts the entries after it back instead of
+// leaving tombstones. Keys must not be mutated while they are in a table.
+class HashTable : public Object {
+public:
+    // Sized to hold `expected` keys without growing.
+    explicit HashTable(size_t expected = 0);
+
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+
+    // Nullptr when the key is missing.
+    std::shared_ptr<Object>* Find(const std::shared_ptr<Object>& key);
+
+    void Set(const std::shared_ptr<Object>& key, std::shared_ptr<Object> value);
+
+    // Whether the key was there.
+    bool Erase(const std::shared_ptr<Object>& key);
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    // The keys and values in slot order.
+    std::vector<std::pair<std::shared_ptr<Object>, std::shared_ptr<Object>>> GetEntries() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<Object> key;
+        std::shared_ptr<Object> value;
+    };
+
+    // Slot holding the key, or the empty slot where it belongs. The table must not be full.
+    size_t Probe(uint64_t hash, const std::shared_ptr<Object>& key) const;
+
+    void Resize(size_t capacity);
+
+    // Zero marks an empty slot; hashes of keys are never zero.
+    std::vector<uint64_t, HeapAllocator<uint64_t>> hashes_;
+    std::vector<Entry, HeapAllocator<Entry>> entries_;
+    size_t size_ = 0;
+    // Slots are picked by the top bits of the hash.
+    int shift_ = 64;
+};
+
+class MakeHashTable : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class HashTableSet : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class HashTableRef : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class HashTableDelete : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class HashTableCount : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
@@ -0,0 +1,18 @@
+#include "heap.h"
+
+#include <cstdlib>
+
+#include <cxxabi.h>
+
+thread_local constinit Heap* current_heap = nullptr;
+
+std::string Demangle(const char* name) {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status != 0) {
+        return name;
+    }
+    std::string result = demangled;
+    std::free(demangled);
+    return result;
+}
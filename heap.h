@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <typeinfo>
+
+#include "error.h"
+#include "stats.h"
+
+class AllocationProfile;
+
+// Records allocations and frees of a type in a profile. Defined with the profile.
+void ProfileAllocation(AllocationProfile* profile, const char* type, size_t bytes);
+void ProfileFree(AllocationProfile* profile, const char* type, size_t bytes);
+
+// Live bytes of the objects allocated by one interpreter. Objects are charged when allocated
+// and credited when freed, from whichever thread frees them.
+class Heap {
+public:
+    void Charge(size_t bytes) {
+        auto used = used_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        if (limit_ && used > limit_) [[unlikely]] {
+            used_.fetch_sub(bytes, std::memory_order_relaxed);
+            throw LimitError();
+        }
+        auto peak = peak_.load(std::memory_order_relaxed);
+        while (used > peak && !peak_.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+        }
+    }
+
+    void Credit(size_t bytes) {
+        used_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    size_t GetUsed() const {
+        return used_.load(std::memory_order_relaxed);
+    }
+
+    // The most bytes used at once since the last ResetPeak.
+    size_t GetPeak() const {
+        return peak_.load(std::memory_order_relaxed);
+    }
+
+    void ResetPeak() {
+        peak_.store(GetUsed(), std::memory_order_relaxed);
+    }
+
+    // Zero means unlimited.
+    void SetLimit(size_t bytes) {
+        limit_ = bytes;
+    }
+
+    // Allocations are recorded in the profile when one is set.
+    AllocationProfile* GetProfile() const {
+        return profile_;
+    }
+
+    void SetProfile(AllocationProfile* profile) {
+        profile_ = profile;
+    }
+
+private:
+    std::atomic<size_t> used_ = 0;
+    std::atomic<size_t> peak_ = 0;
+    size_t limit_ = 0;
+    AllocationProfile* profile_ = nullptr;
+};
+
+// Heap of the interpreter running on this thread, nullptr when objects are not accounted.
+extern thread_local constinit Heap* current_heap;
+
+class HeapGuard {
+public:
+    HeapGuard(Heap* heap) : saved_(current_heap) {
+        current_heap = heap;
+    }
+
+    ~HeapGuard() {
+        current_heap = saved_;
+    }
+
+private:
+    Heap* saved_;
+};
+
+std::string Demangle(const char* name);
+
+// Readable name of a type, as shown by allocation profiles.
+template <class T>
+const char* TypeName() {
+    static const std::string name = Demangle(typeid(T).name());
+    return name.c_str();
+}
+
+// Charges the allocations it makes to a heap. `type` names what is allocated in profiles.
+template <class T>
+class HeapAllocator {
+public:
+    using value_type = T;
+
+    HeapAllocator(Heap* heap, const char* type) : heap_(heap), type_(type) {
+    }
+
+    template <class U>
+    HeapAllocator(const HeapAllocator<U>& other)
+        : heap_(other.GetHeap()), type_(other.GetType()) {
+    }
+
+    T* allocate(size_t n) {
+        if (heap_) {
+            heap_->Charge(n * sizeof(T));
+            ++eval_counters.allocations;
+            eval_counters.allocated_bytes += n * sizeof(T);
+            if (auto profile = heap_->GetProfile()) [[unlikely]] {
+                ProfileAllocation(profile, type_, n * sizeof(T));
+            }
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        std::allocator<T>().deallocate(ptr, n);
+        if (heap_) {
+            heap_->Credit(n * sizeof(T));
+            ++eval_counters.frees;
+            eval_counters.freed_bytes += n * sizeof(T);
+            if (auto profile = heap_->GetProfile()) [[unlikely]] {
+                ProfileFree(profile, type_, n * sizeof(T));
+            }
+        }
+    }
+
+    Heap* GetHeap() const {
+        return heap_;
+    }
+
+    const char* GetType() const {
+        return type_;
+    }
+
+    template <class U>
+    bool operator==(const HeapAllocator<U>& other) const {
+        return heap_ == other.GetHeap();
+    }
+
+private:
+    Heap* heap_;
+    const char* type_;
+};
+
+// Allocates an object of the running interpreter. The object and its control block share one
+// allocation, which is charged to the interpreter's heap.
+template <class T, class... Args>
+std::shared_ptr<T> Make(Args&&... args) {
+    return std::allocate_shared<T>(HeapAllocator<T>(current_heap, TypeName<T>()),
+                                   std::forward<Args>(args)...);
+}
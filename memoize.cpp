@@ -0,0 +1,86 @@
+#include "memoize.h"
+
+size_t Memoized::KeyHash::operator()(const Key& key) const {
+    size_t result = key.size();
+    for (const auto& arg : key) {
+        result ^= StructuralHash(arg) + 0x9e3779b97f4a7c15 + (result << 6) + (result >> 2);
+    }
+    return result;
+}
+
+bool Memoized::KeyEqual::operator()(const Key& lhs, const Key& rhs) const {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), StructuralEqual);
+}
+
+Memoized::Memoized(std::shared_ptr<Function> function, size_t capacity)
+    : function_(std::move(function)), capacity_(capacity) {
+}
+
+std::shared_ptr<Object> Memoized::Apply(std::shared_ptr<Object> head) {
+    return Call(EvalArgs(head));
+}
+
+std::shared_ptr<Object> Memoized::Call(const std::vector<std::shared_ptr<Object>>& args) {
+    {
+        std::lock_guard lock(mutex_);
+        if (auto it = index_.find(args); it != index_.end()) {
+            ++hits_;
+            ++eval_counters.memo_hits;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return it->second->value;
+        }
+        ++misses_;
+        ++eval_counters.memo_misses;
+    }
+    auto value = function_->Call(args);
+    std::lock_guard lock(mutex_);
+    // The call may have filled the cache with the same key through recursion.
+    if (auto it = index_.find(args); it != index_.end()) {
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return value;
+    }
+    if (entries_.size() == capacity_) {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+    entries_.push_front({args, value});
+    index_.emplace(args, entries_.begin());
+    return value;
+}
+
+std::shared_ptr<Object> Memoize::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.empty() || args.size() > 2 || !Is<Function>(args[0])) {
+        throw RuntimeError();
+    }
+    size_t capacity = Memoized::kDefaultCapacity;
+    if (args.size() == 2) {
+        if (!Is<Number>(args[1]) || As<Number>(args[1])->GetValue() <= 0) {
+            throw RuntimeError();
+        }
+        capacity = As<Number>(args[1])->GetValue();
+    }
+    return Make<Memoized>(As<Function>(args[0]), capacity);
+}
+
+std::shared_ptr<Object> MemoizeStats::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1 || !Is<Memoized>(args[0])) {
+        throw RuntimeError();
+    }
+    auto memoized = As<Memoized>(args[0]);
+    return Make<Cell>(
+        Make<Number>(memoized->GetHits()),
+        Make<Cell>(Make<Number>(memoized->GetMisses()), nullptr));
+}
+
+std::shared_ptr<Object> DefineMemoized::Apply(std::shared_ptr<Object> head) {
+    auto args = ToArgs(head);
+    if (args.size() < 2 || !Is<Cell>(args[0]) || !Is<Symbol>(As<Cell>(args[0])->GetFirst())) {
+        throw SyntaxError();
+    }
+    auto closure = MakeClosure(As<Cell>(args[0])->GetSecond(), {args.begin() + 1, args.end()});
+    DefineVariable(As<Symbol>(As<Cell>(args[0])->GetFirst())->GetName(),
+                   Make<Memoized>(As<Function>(closure)));
+    return nullptr;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "object.h"
+
+// Wraps a function with a bounded cache of results keyed on the structure of its arguments.
+// The least recently used entry is evicted once the cache is full.
+class Memoized : public Function {
+public:
+    static constexpr size_t kDefaultCapacity = 1024;
+
+    Memoized(std::shared_ptr<Function> function, size_t capacity = kDefaultCapacity);
+
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+
+    std::shared_ptr<Object> Call(const std::vector<std::shared_ptr<Object>>& args) override;
+
+    uint64_t GetHits() const {
+        return hits_;
+    }
+
+    uint64_t GetMisses() const {
+        return misses_;
+    }
+
+    size_t GetSize() const {
+        return entries_.size();
+    }
+
+    const std::shared_ptr<Function>& GetFunction() const {
+        return function_;
+    }
+
+    size_t GetCapacity() const {
+        return capacity_;
+    }
+
+private:
+    using Key = std::vector<std::shared_ptr<Object>>;
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct KeyEqual {
+        bool operator()(const Key& lhs, const Key& rhs) const;
+    };
+
+    struct Entry {
+        Key key;
+        std::shared_ptr<Object> value;
+    };
+
+    std::shared_ptr<Function> function_;
+    size_t capacity_;
+    // Held around cache lookups and updates only, never across the wrapped call.
+    std::mutex mutex_;
+    std::list<Entry> entries_;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash, KeyEqual> index_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+class Memoize : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class MemoizeStats : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class DefineMemoized : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
@@ -1,6 +1,18 @@
 #include "object.h"
+#include "budget.h"
+#include "compiler.h"
+#include "hashtable.h"
+#include "memoize.h"
+#include "parallel.h"
+#include "profile.h"
+#include "reduce.h"
+#include "sampler.h"
+#include "stats.h"
+#include "stream.h"
 
-std::unordered_map<std::string, std::shared_ptr<Function>> functions = {
+#include <atomic>
+
+const std::unordered_map<std::string, std::shared_ptr<Function>> builtins = {
     {"boolean?", std::make_shared<BooleanPredicate>()},
     {"number?", std::make_shared<NumberPredicate>()},
     {"pair?", std::make_shared<Pair>()},
@@ -9,9 +21,31 @@ std::unordered_map<std::string, std::shared_ptr<Function>> functions = {
     {"cons", std::make_shared<Cons>()},
     {"car", std::make_shared<Car>()},
     {"cdr", std::make_shared<Cdr>()},
+    {"set-car!", std::make_shared<SetCar>()},
+    {"set-cdr!", std::make_shared<SetCdr>()},
     {"list", std::make_shared<List>()},
     {"list-ref", std::make_shared<Ref>()},
     {"list-tail", std::make_shared<Tail>()},
+    {"equal?", std::make_shared<EqualPredicate>()},
+    {"string?", std::make_shared<StringPredicate>()},
+    {"string-length", std::make_shared<StringLength>()},
+    {"substring", std::make_shared<Substring>()},
+    {"string-append", std::make_shared<StringAppend>()},
+    {"string=?", std::make_shared<StringEqual>()},
+    {"string->symbol", std::make_shared<StringToSymbol>()},
+    {"symbol->string", std::make_shared<SymbolToString>()},
+    {"make-vector", std::make_shared<MakeVector>()},
+    {"vector", std::make_shared<BuildVector>()},
+    {"vector-ref", std::make_shared<VectorRef>()},
+    {"vector-set!", std::make_shared<VectorSet>()},
+    {"vector-length", std::make_shared<VectorLength>()},
+    {"list->vector", std::make_shared<ListToVector>()},
+    {"vector->list", std::make_shared<VectorToList>()},
+    {"make-hash-table", std::make_shared<MakeHashTable>()},
+    {"hash-table-set!", std::make_shared<HashTableSet>()},
+    {"hash-table-ref", std::make_shared<HashTableRef>()},
+    {"hash-table-delete!", std::make_shared<HashTableDelete>()},
+    {"hash-table-count", std::make_shared<HashTableCount>()},
     {"+", std::make_shared<Sum>()},
     {"-", std::make_shared<Sub>()},
     {"*", std::make_shared<Mul>()},
@@ -24,12 +58,170 @@ std::unordered_map<std::string, std::shared_ptr<Function>> functions = {
     {"min", std::make_shared<Min>()},
     {"max", std::make_shared<Max>()},
     {"abs", std::make_shared<Abs>()},
+    {"apply", std::make_shared<ApplyList>()},
+    {"memoize", std::make_shared<Memoize>()},
+    {"memoize-stats", std::make_shared<MemoizeStats>()},
+    {"define-memoized", std::make_shared<DefineMemoized>()},
+    {"delay", std::make_shared<Delay>()},
+    {"force", std::make_shared<Force>()},
+    {"cons-stream", std::make_shared<ConsStream>()},
+    {"stream-car", std::make_shared<StreamCar>()},
+    {"stream-cdr", std::make_shared<StreamCdr>()},
+    {"stream-null?", std::make_shared<StreamNull>()},
+    {"future", std::make_shared<MakeFuture>()},
+    {"touch", std::make_shared<Touch>()},
+    {"pmap", std::make_shared<ParallelMap>()},
     {"not", std::make_shared<Not>()},
     {"and", std::make_shared<And>()},
     {"or", std::make_shared<Or>()},
+    {"if", std::make_shared<If>()},
+    {"define", std::make_shared<Define>()},
+    {"set!", std::make_shared<Set>()},
+    {"lambda", std::make_shared<Lambda>()},
     {"quote", std::make_shared<Quote>()},
 };
 
+const std::unordered_map<std::string, std::shared_ptr<Function>>& GetBuiltins() {
+    return builtins;
+}
+
+// Each environment numbers its versions from its own base, leaving room for 2^40 bumps.
+std::atomic<uint64_t> next_environment = 0;
+
+Environment::Environment() : version_((++next_environment) << 40) {
+    for (const auto& [name, function] : builtins) {
+        globals_[name].value = function;
+    }
+}
+
+std::vector<std::pair<std::string, std::shared_ptr<Object>>> Environment::GetBindings() {
+    std::shared_lock lock(mutex_);
+    std::vector<std::pair<std::string, std::shared_ptr<Object>>> result;
+    for (const auto& [name, binding] : globals_) {
+        result.emplace_back(name, binding.value);
+    }
+    return result;
+}
+
+Binding* Environment::Find(const std::string& name) {
+    std::shared_lock lock(mutex_);
+    auto it = globals_.find(name);
+    if (it == globals_.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+// Slots are never erased, so Binding pointers stay valid while the table grows. While tasks
+// run on a pool, new globals can still be defined, but existing slots are frozen.
+void Environment::Define(const std::string& name, std::shared_ptr<Object> value) {
+    std::lock_guard lock(mutex_);
+    if (sealed_ || (InParallel() && globals_.contains(name))) {
+        throw RuntimeError();
+    }
+    globals_[name].value = value;
+    Invalidate();
+}
+
+void Environment::Set(const std::string& name, std::shared_ptr<Object> value) {
+    auto binding = Find(name);
+    if (!binding) {
+        throw NameError();
+    }
+    if (sealed_ || InParallel()) {
+        throw RuntimeError();
+    }
+    binding->value = value;
+    Invalidate();
+}
+
+const std::vector<std::string>& GetCallSlotNames() {
+    static const auto names = [] {
+        std::vector<std::string> result(1);
+        for (const auto& [name, function] : builtins) {
+            result.push_back(name);
+        }
+        std::sort(result.begin() + 1, result.end());
+        if (result.size() > kCallSlots) {
+            throw std::logic_error("too many builtins for the call counters");
+        }
+        for (size_t slot = 1; slot < result.size(); ++slot) {
+            builtins.at(result[slot])->SetCallSlot(slot);
+        }
+        return result;
+    }();
+    return names;
+}
+
+Environment* MakeBuiltinEnvironment() {
+    GetCallSlotNames();
+    static Environment environment;
+    environment.Seal();
+    return &environment;
+}
+
+Environment* const builtin_environment = MakeBuiltinEnvironment();
+
+thread_local Environment* current_environment = nullptr;
+
+Environment* CurrentEnvironment() {
+    return current_environment ? current_environment : builtin_environment;
+}
+
+EnvironmentGuard::EnvironmentGuard(Environment* environment) : saved_(current_environment) {
+    current_environment = environment;
+}
+
+EnvironmentGuard::~EnvironmentGuard() {
+    current_environment = saved_;
+}
+
+Binding* FindBinding(const std::string& name) {
+    return CurrentEnvironment()->Find(name);
+}
+
+void DefineGlobal(const std::string& name, std::shared_ptr<Object> value) {
+    CurrentEnvironment()->Define(name, value);
+}
+
+void SetGlobal(const std::string& name, std::shared_ptr<Object> value) {
+    CurrentEnvironment()->Set(name, value);
+}
+
+// Innermost local scope of the running closure, nullptr at top level.
+thread_local std::shared_ptr<Scope> current_scope;
+
+ScopeGuard::ScopeGuard(std::shared_ptr<Scope> scope) : saved_(current_scope) {
+    current_scope = scope;
+}
+
+ScopeGuard::~ScopeGuard() {
+    current_scope = saved_;
+}
+
+Binding* Scope::Find(const std::string& name) {
+    for (auto scope = this; scope; scope = scope->parent_.get()) {
+        auto it = scope->variables_.find(name);
+        if (it != scope->variables_.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+void Scope::Define(const std::string& name, std::shared_ptr<Object> value) {
+    variables_[name].value = value;
+}
+
+void DefineVariable(const std::string& name, std::shared_ptr<Object> value) {
+    if (current_scope) {
+        current_scope->Define(name, value);
+        CurrentEnvironment()->Invalidate();
+    } else {
+        DefineGlobal(name, value);
+    }
+}
+
 std::vector<std::shared_ptr<Object>> ToVector(const std::shared_ptr<Object>& head) {
     std::vector<std::shared_ptr<Object>> result;
     if (!head) {
@@ -45,419 +237,927 @@ std::vector<std::shared_ptr<Object>> ToVector(const std::shared_ptr<Object>& hea
         result.push_back(As<Symbol>(head));
     } else if (Is<Boolean>(head)) {
         result.push_back(As<Boolean>(head));
+    } else if (Is<String>(head)) {
+        result.push_back(As<String>(head));
     }
     return result;
 }
 
-template <class T>
-void ValidateArgsType(std::vector<std::shared_ptr<Object>> data) {
-    for (size_t i = 0; i < data.size(); ++i) {
-        if (!Is<T>(data[i])) {
+std::vector<std::shared_ptr<Object>> ToArgs(const std::shared_ptr<Object>& head) {
+    std::vector<std::shared_ptr<Object>> result;
+    auto cur = head;
+    while (cur) {
+        if (!Is<Cell>(cur)) {
+            throw SyntaxError();
+        }
+        result.push_back(As<Cell>(cur)->GetFirst());
+        cur = As<Cell>(cur)->GetSecond();
+    }
+    return result;
+}
+
+std::vector<std::shared_ptr<Object>> EvalArgs(const std::shared_ptr<Object>& head) {
+    auto args = ToArgs(head);
+    for (auto& arg : args) {
+        if (!arg) {
             throw RuntimeError();
         }
+        arg = arg->Eval();
+    }
+    return args;
+}
+
+std::shared_ptr<Object> EvalTail(const std::shared_ptr<Object>& expr) {
+    if (auto cell = dynamic_cast<Cell*>(expr.get())) {
+        bool applied;
+        return cell->EvalForm(&applied, true);
+    }
+    return expr->Eval();
+}
+
+int64_t GetIndex(const std::shared_ptr<Object>& obj) {
+    if (!Is<Number>(obj) || As<Number>(obj)->GetValue() < 0) {
+        throw RuntimeError();
+    }
+    return As<Number>(obj)->GetValue();
+}
+
+size_t StructuralHash(const std::shared_ptr<Object>& obj) {
+    // Lists are hashed along their whole spine, up to where it runs into a cycle. Structure nested
+    // in cars and vectors, which can be cyclic as well, is hashed down to a fixed depth.
+    constexpr int kMaxDepth = 16;
+    size_t result = 0;
+    auto mix = [&result](size_t value) { result ^= value + 0x9e3779b97f4a7c15 + (result << 6); };
+    std::vector<std::pair<std::shared_ptr<Object>, int>> stack{{obj, 0}};
+    while (!stack.empty()) {
+        auto [cur, depth] = stack.back();
+        stack.pop_back();
+        if (!cur) {
+            mix(0);
+        } else if (Is<Number>(cur)) {
+            mix(std::hash<int64_t>()(As<Number>(cur)->GetValue()));
+        } else if (Is<Boolean>(cur)) {
+            mix(As<Boolean>(cur)->GetValue() ? 1 : 2);
+        } else if (Is<Symbol>(cur)) {
+            mix(std::hash<std::string>()(As<Symbol>(cur)->GetName()));
+        } else if (Is<String>(cur)) {
+            mix(std::hash<std::string_view>()(As<String>(cur)->GetView()) + 6);
+        } else if (depth == kMaxDepth) {
+            mix(3);
+        } else if (Is<Cell>(cur)) {
+            // `slow` follows at half speed and meets `cur` once the spine loops.
+            auto slow = cur;
+            size_t length = 0;
+            while (Is<Cell>(cur)) {
+                stack.emplace_back(As<Cell>(cur)->GetFirst(), depth + 1);
+                cur = As<Cell>(cur)->GetSecond();
+                if (++length % 2 == 0) {
+                    slow = As<Cell>(slow)->GetSecond();
+                }
+                if (cur == slow) {
+                    cur = nullptr;
+                    mix(3);
+                    break;
+                }
+            }
+            mix(4 + length);
+            stack.emplace_back(cur, depth + 1);
+        } else if (Is<Vector>(cur)) {
+            mix(5);
+            for (const auto& element : As<Vector>(cur)->GetElements()) {
+                stack.emplace_back(element, depth + 1);
+            }
+        } else {
+            mix(std::hash<Object*>()(cur.get()));
+        }
     }
+    return result;
 }
 
-template <class Result, class T, class F, class It>
-std::shared_ptr<Result> Fold(It begin, It end, T init, F f) {
-    T result = init;
-    while (begin != end) {
-        result = f(result, As<Result>(*begin)->GetValue());
-        ++begin;
+bool StructuralEqual(const std::shared_ptr<Object>& lhs, const std::shared_ptr<Object>& rhs) {
+    // Lists are compared along their spines in a loop, and only the cars recursively.
+    auto left = lhs;
+    auto right = rhs;
+    while (left != right && Is<Cell>(left) && Is<Cell>(right)) {
+        if (!StructuralEqual(As<Cell>(left)->GetFirst(), As<Cell>(right)->GetFirst())) {
+            return false;
+        }
+        left = As<Cell>(left)->GetSecond();
+        right = As<Cell>(right)->GetSecond();
+    }
+    if (left == right) {
+        return true;
+    } else if (!left || !right) {
+        return false;
+    } else if (Is<Number>(left) && Is<Number>(right)) {
+        return As<Number>(left)->GetValue() == As<Number>(right)->GetValue();
+    } else if (Is<Boolean>(left) && Is<Boolean>(right)) {
+        return As<Boolean>(left)->GetValue() == As<Boolean>(right)->GetValue();
+    } else if (Is<Symbol>(left) && Is<Symbol>(right)) {
+        return As<Symbol>(left)->GetName() == As<Symbol>(right)->GetName();
+    } else if (Is<String>(left) && Is<String>(right)) {
+        return As<String>(left)->GetView() == As<String>(right)->GetView();
+    } else if (Is<Vector>(left) && Is<Vector>(right)) {
+        const auto& left_elements = As<Vector>(left)->GetElements();
+        const auto& right_elements = As<Vector>(right)->GetElements();
+        return std::equal(left_elements.begin(), left_elements.end(), right_elements.begin(),
+                          right_elements.end(), StructuralEqual);
+    } else {
+        return false;
     }
-    return std::make_shared<Result>(result);
+}
+
+std::vector<int64_t> GatherNumbers(const std::shared_ptr<Object>& list) {
+    std::vector<int64_t> result;
+    for (auto cur = list; cur; cur = As<Cell>(cur)->GetSecond()) {
+        if (!Is<Cell>(cur) || !Is<Number>(As<Cell>(cur)->GetFirst())) {
+            throw RuntimeError();
+        }
+        result.push_back(As<Number>(As<Cell>(cur)->GetFirst())->GetValue());
+    }
+    return result;
+}
+
+Binding* Symbol::Resolve(bool* is_global) {
+    if (binding_ && version_ == CurrentEnvironment()->GetVersion()) {
+        if (is_global) {
+            *is_global = true;
+        }
+        return binding_;
+    }
+    if (current_scope) {
+        if (auto binding = current_scope->Find(value_)) {
+            if (is_global) {
+                *is_global = false;
+            }
+            return binding;
+        }
+    }
+    auto binding = FindBinding(value_);
+    if (!InParallel()) {
+        binding_ = binding;
+        version_ = CurrentEnvironment()->GetVersion();
+    }
+    if (is_global) {
+        *is_global = true;
+    }
+    return binding;
 }
 
 std::shared_ptr<Object> Symbol::Eval() {
-    if (functions.contains(GetName())) {
-        return functions.at(GetName());
+    if (auto binding = Resolve()) {
+        return binding->value;
     } else if (GetName() == "#t") {
-        return std::make_shared<Boolean>(true);
+        return Make<Boolean>(true);
     } else if (GetName() == "#f") {
-        return std::make_shared<Boolean>(false);
+        return Make<Boolean>(false);
     } else {
-        return std::make_shared<Symbol>(value_);
+        throw NameError();
     }
 }
 
 std::shared_ptr<Object> Boolean::Eval() {
-    return std::make_shared<Boolean>(value_);
+    return Make<Boolean>(value_);
+}
+
+namespace {
+
+// Applies a function while profiling or sampling. Closures push their own frame once their
+// arguments are evaluated.
+std::shared_ptr<Object> ApplyInstrumented(Function* function, const std::shared_ptr<Object>& args,
+                                          bool tail) {
+    AllocationSiteGuard site_guard(allocation_site ? SiteName(function) : nullptr);
+    CallFrame frame(dynamic_cast<Closure*>(function) ? nullptr : function);
+    return tail ? function->ApplyTail(args) : function->Apply(args);
+}
+
+}  // namespace
+
+Cell::~Cell() {
+    auto rest = std::move(second_);
+    while (rest && rest.use_count() == 1) {
+        auto cell = dynamic_cast<Cell*>(rest.get());
+        if (!cell) {
+            break;
+        }
+        rest = std::move(cell->second_);
+    }
 }
 
 std::shared_ptr<Object> Cell::Eval() {
+    bool applied;
+    return EvalForm(&applied);
+}
+
+std::shared_ptr<Object> Cell::EvalForm(bool* applied, bool tail) {
     if (!first_) {
         throw RuntimeError();
     }
+    *applied = true;
+    CountStep();
+    DepthGuard depth_guard;
+    if (callee_version_ == CurrentEnvironment()->GetVersion()) {
+        ++eval_counters.callee_cache_hits;
+        ++eval_counters.calls[static_cast<Function*>(callee_->value.get())->GetCallSlot()];
+        auto callee = static_cast<Function*>(callee_->value.get());
+        if (allocation_site || call_stack) [[unlikely]] {
+            return ApplyInstrumented(callee, second_, tail);
+        }
+        return tail ? callee->ApplyTail(second_) : callee->Apply(second_);
+    }
     auto temp1 = first_->Eval();
     if (Is<Function>(temp1)) {
-        return temp1->Apply(second_);
+        ++eval_counters.callee_cache_misses;
+        ++eval_counters.calls[static_cast<Function*>(temp1.get())->GetCallSlot()];
+        if (Is<Symbol>(first_)) {
+            bool is_global = false;
+            auto binding = As<Symbol>(first_)->Resolve(&is_global);
+            if (is_global && !InParallel()) {
+                callee_ = binding;
+                callee_version_ = CurrentEnvironment()->GetVersion();
+            }
+        }
+        auto callee = static_cast<Function*>(temp1.get());
+        if (allocation_site || call_stack) [[unlikely]] {
+            return ApplyInstrumented(callee, second_, tail);
+        }
+        return tail ? callee->ApplyTail(second_) : callee->Apply(second_);
     } else {
+        *applied = false;
         auto temp2 = second_;
         if (second_) {
             temp2 = second_->Eval();
         }
-        return std::make_shared<Cell>(temp1, temp2);
+        return Make<Cell>(temp1, temp2);
     }
 }
 
 std::shared_ptr<Object> BooleanPredicate::Apply(std::shared_ptr<Object> head) {
-    return std::make_shared<Boolean>(Is<Boolean>(As<Cell>(head)->GetFirst()->Eval()));
+    return Make<Boolean>(Is<Boolean>(As<Cell>(head)->GetFirst()->Eval()));
 }
 
 std::shared_ptr<Object> NumberPredicate::Apply(std::shared_ptr<Object> head) {
-    return std::make_shared<Boolean>(Is<Number>(As<Cell>(head)->GetFirst()->Eval()));
+    return Make<Boolean>(Is<Number>(As<Cell>(head)->GetFirst()->Eval()));
 }
 
-std::shared_ptr<Object> Sum::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
-        return std::make_shared<Number>(0);
-    } else if (vec.size() == 1) {
-        return vec[0];
-    } else {
-        return Fold<Number>(vec.begin() + 1, vec.end(), As<Number>(vec[0])->GetValue(),
-                            [](int64_t x, int64_t y) { return x + y; });
+std::shared_ptr<Object> Function::Call(const std::vector<std::shared_ptr<Object>>& args) {
+    // Builtins evaluate their arguments, so the values are passed quoted.
+    std::shared_ptr<Object> quoted;
+    auto quote = Make<Symbol>("quote");
+    for (auto it = args.rbegin(); it != args.rend(); ++it) {
+        quoted = Make<Cell>(Make<Cell>(quote, Make<Cell>(*it, nullptr)), quoted);
     }
+    return Apply(quoted);
 }
 
-std::shared_ptr<Object> Sub::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
+std::shared_ptr<Object> NumericFunction::Apply(std::shared_ptr<Object> head) {
+    std::vector<int64_t> args;
+    for (auto cur = head; cur; cur = As<Cell>(cur)->GetSecond()) {
+        if (!Is<Cell>(cur) || !As<Cell>(cur)->GetFirst()) {
+            throw RuntimeError();
+        }
+        auto arg = As<Cell>(cur)->GetFirst();
+        if (!Is<Number>(arg)) {
+            arg = arg->Eval();
+        }
+        if (!Is<Number>(arg)) {
+            throw RuntimeError();
+        }
+        args.push_back(As<Number>(arg)->GetValue());
     }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
+    return Compute(args);
+}
+
+std::shared_ptr<Object> Sum::Compute(const std::vector<int64_t>& args) {
+    auto result = SumNumbers(args.data(), args.size());
+    if (!result) {
         throw RuntimeError();
-    } else if (vec.size() == 1) {
-        return std::make_shared<Number>(-1 * As<Number>(vec[0])->GetValue());
-    } else {
-        return Fold<Number>(vec.begin() + 1, vec.end(), As<Number>(vec[0])->GetValue(),
-                            [](int64_t x, int64_t y) { return x - y; });
     }
+    return Make<Number>(*result);
 }
-std::shared_ptr<Object> Mul::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
-        return std::make_shared<Number>(1);
-    } else if (vec.size() == 1) {
-        return vec[0];
-    } else {
-        return Fold<Number>(vec.begin() + 1, vec.end(), As<Number>(vec[0])->GetValue(),
-                            [](int64_t x, int64_t y) { return x * y; });
+
+std::shared_ptr<Object> Sub::Compute(const std::vector<int64_t>& args) {
+    if (args.size() == 0) {
+        throw RuntimeError();
     }
-}
-std::shared_ptr<Object> Div::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
+    int64_t result = 0;
+    if (args.size() == 1) {
+        if (__builtin_sub_overflow(0, args[0], &result)) {
+            throw RuntimeError();
+        }
+        return Make<Number>(result);
     }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
-        throw RuntimeError();
-    } else if (vec.size() == 1) {
+    auto rest = SumNumbers(args.data() + 1, args.size() - 1);
+    if (!rest || __builtin_sub_overflow(args[0], *rest, &result)) {
         throw RuntimeError();
-    } else {
-        return Fold<Number>(vec.begin() + 1, vec.end(), As<Number>(vec[0])->GetValue(),
-                            [](int64_t x, int64_t y) { return x / y; });
     }
+    return Make<Number>(result);
 }
 
-std::shared_ptr<Object> Equ::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
-        return std::make_shared<Boolean>(true);
-    } else if (vec.size() == 1) {
+std::shared_ptr<Object> Mul::Compute(const std::vector<int64_t>& args) {
+    auto result = MulNumbers(args.data(), args.size());
+    if (!result) {
         throw RuntimeError();
-    } else {
-        for (size_t i = 1; i < vec.size(); ++i) {
-            if (As<Number>(vec[0])->GetValue() != As<Number>(vec[i])->GetValue()) {
-                return std::make_shared<Boolean>(false);
-            }
-        }
-        return std::make_shared<Boolean>(true);
     }
+    return Make<Number>(*result);
 }
 
-std::shared_ptr<Object> Les::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
-        return std::make_shared<Boolean>(true);
-    } else if (vec.size() == 1) {
+std::shared_ptr<Object> Div::Compute(const std::vector<int64_t>& args) {
+    if (args.size() < 2) {
         throw RuntimeError();
-    } else {
-        for (size_t i = 1; i < vec.size(); ++i) {
-            if (As<Number>(vec[0])->GetValue() >= As<Number>(vec[i])->GetValue()) {
-                return std::make_shared<Boolean>(false);
-            }
+    }
+    int64_t result = args[0];
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == 0 || (result == INT64_MIN && args[i] == -1)) {
+            throw RuntimeError();
         }
-        return std::make_shared<Boolean>(true);
+        result /= args[i];
     }
+    return Make<Number>(result);
 }
 
-std::shared_ptr<Object> Gre::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
-        return std::make_shared<Boolean>(true);
-    } else if (vec.size() == 1) {
+std::shared_ptr<Object> CompareNumbers(const std::vector<int64_t>& args, Order order) {
+    if (args.size() == 1) {
         throw RuntimeError();
-    } else {
-        for (size_t i = 1; i < vec.size(); ++i) {
-            if (As<Number>(vec[0])->GetValue() <= As<Number>(vec[i])->GetValue()) {
-                return std::make_shared<Boolean>(false);
-            }
-        }
-        return std::make_shared<Boolean>(true);
     }
+    return Make<Boolean>(IsOrdered(args.data(), args.size(), order));
 }
 
-std::shared_ptr<Object> Loe::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
-        return std::make_shared<Boolean>(true);
-    } else if (vec.size() == 1) {
-        throw RuntimeError();
-    } else {
-        for (size_t i = 1; i < vec.size(); ++i) {
-            if (As<Number>(vec[0])->GetValue() > As<Number>(vec[i])->GetValue()) {
-                return std::make_shared<Boolean>(false);
-            }
-        }
-        return std::make_shared<Boolean>(true);
-    }
+std::shared_ptr<Object> Equ::Compute(const std::vector<int64_t>& args) {
+    return CompareNumbers(args, Order::EQUAL);
 }
 
-std::shared_ptr<Object> Goe::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
-        return std::make_shared<Boolean>(true);
-    } else if (vec.size() == 1) {
+std::shared_ptr<Object> Les::Compute(const std::vector<int64_t>& args) {
+    return CompareNumbers(args, Order::LESS);
+}
+
+std::shared_ptr<Object> Gre::Compute(const std::vector<int64_t>& args) {
+    return CompareNumbers(args, Order::GREATER);
+}
+
+std::shared_ptr<Object> Loe::Compute(const std::vector<int64_t>& args) {
+    return CompareNumbers(args, Order::LESS_EQUAL);
+}
+
+std::shared_ptr<Object> Goe::Compute(const std::vector<int64_t>& args) {
+    return CompareNumbers(args, Order::GREATER_EQUAL);
+}
+
+std::shared_ptr<Object> Min::Compute(const std::vector<int64_t>& args) {
+    if (args.size() == 0) {
         throw RuntimeError();
-    } else {
-        for (size_t i = 1; i < vec.size(); ++i) {
-            if (As<Number>(vec[0])->GetValue() < As<Number>(vec[i])->GetValue()) {
-                return std::make_shared<Boolean>(false);
-            }
-        }
-        return std::make_shared<Boolean>(true);
     }
+    return Make<Number>(MinNumber(args.data(), args.size()));
 }
 
-std::shared_ptr<Object> Min::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
+std::shared_ptr<Object> Max::Compute(const std::vector<int64_t>& args) {
+    if (args.size() == 0) {
         throw RuntimeError();
-    } else if (vec.size() == 1) {
-        return vec[0];
-    } else {
-        return Fold<Number>(vec.begin() + 1, vec.end(), As<Number>(vec[0])->GetValue(),
-                            [](int64_t x, int64_t y) { return std::min(x, y); });
     }
+    return Make<Number>(MaxNumber(args.data(), args.size()));
 }
 
-std::shared_ptr<Object> Max::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
+std::shared_ptr<Object> Abs::Compute(const std::vector<int64_t>& args) {
+    if (args.size() != 1 || args[0] == INT64_MIN) {
         throw RuntimeError();
-    } else if (vec.size() == 1) {
-        return vec[0];
-    } else {
-        return Fold<Number>(vec.begin() + 1, vec.end(), As<Number>(vec[0])->GetValue(),
-                            [](int64_t x, int64_t y) { return std::max(x, y); });
     }
+    return Make<Number>(std::abs(args[0]));
 }
 
-std::shared_ptr<Object> Abs::Apply(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> vec;
-    if (head) {
-        vec = ToVector(head->Eval());
-    }
-    ValidateArgsType<Number>(vec);
-    if (vec.size() == 0) {
+std::shared_ptr<Object> ApplyList::Apply(std::shared_ptr<Object> head) {
+    auto args = ToArgs(head);
+    if (args.size() != 2 || !args[0] || !args[1]) {
         throw RuntimeError();
-    } else if (vec.size() == 1) {
-        return std::make_shared<Number>(std::abs(As<Number>(vec[0])->GetValue()));
-    } else {
+    }
+    auto function = args[0]->Eval();
+    auto list = args[1]->Eval();
+    if (Is<NumericFunction>(function)) {
+        return As<NumericFunction>(function)->Compute(GatherNumbers(list));
+    }
+    if (!Is<Function>(function)) {
         throw RuntimeError();
     }
+    std::vector<std::shared_ptr<Object>> values;
+    for (auto cur = list; cur; cur = As<Cell>(cur)->GetSecond()) {
+        if (!Is<Cell>(cur)) {
+            throw RuntimeError();
+        }
+        values.push_back(As<Cell>(cur)->GetFirst());
+    }
+    return As<Function>(function)->Call(values);
 }
 
 std::shared_ptr<Object> Not::Apply(std::shared_ptr<Object> head) {
-    if (!head) {
-        throw RuntimeError();
-    }
-    if (As<Cell>(head->Eval())->GetSecond()) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
         throw RuntimeError();
     }
-    if (Is<Boolean>(As<Cell>(head)->GetFirst()->Eval())) {
-        return std::make_shared<Boolean>(
-            !As<Boolean>(As<Cell>(head)->GetFirst()->Eval())->GetValue());
-    } else {
-        return std::make_shared<Boolean>(false);
-    }
+    return Make<Boolean>(Is<Boolean>(args[0]) && !As<Boolean>(args[0])->GetValue());
 }
 
 std::shared_ptr<Object> And::Apply(std::shared_ptr<Object> head) {
-    if (!head) {
-        return std::make_shared<Boolean>(true);
-    } else if (Is<Cell>(head)) {
-        if (!Is<Boolean>(Apply(As<Cell>(head)->GetFirst()->Eval())) ||
-            As<Boolean>(Apply(As<Cell>(head)->GetFirst()->Eval()))->GetValue()) {
-            if (As<Cell>(head)->GetSecond()) {
-                return Apply(As<Cell>(head)->GetSecond());
-            } else {
-                return As<Cell>(head)->GetFirst()->Eval();
-            }
-        } else {
-            return std::make_shared<Boolean>(false);
+    std::shared_ptr<Object> result = Make<Boolean>(true);
+    for (auto& arg : ToArgs(head)) {
+        if (!arg) {
+            throw RuntimeError();
+        }
+        result = arg->Eval();
+        if (Is<Boolean>(result) && !As<Boolean>(result)->GetValue()) {
+            return result;
         }
-    } else {
-        return head;
     }
+    return result;
 }
 
 std::shared_ptr<Object> Or::Apply(std::shared_ptr<Object> head) {
-    if (!head) {
-        return std::make_shared<Boolean>(false);
-    } else if (Is<Cell>(head)) {
-        if (!Is<Boolean>(Apply(As<Cell>(head)->GetFirst()->Eval())) ||
-            !As<Boolean>(Apply(As<Cell>(head)->GetFirst()->Eval()))->GetValue()) {
-            if (As<Cell>(head)->GetSecond()) {
-                return Apply(As<Cell>(head)->GetSecond());
-            } else {
-                return As<Cell>(head)->GetFirst()->Eval();
-            }
-        } else {
-            return std::make_shared<Boolean>(true);
+    std::shared_ptr<Object> result = Make<Boolean>(false);
+    for (auto& arg : ToArgs(head)) {
+        if (!arg) {
+            throw RuntimeError();
+        }
+        result = arg->Eval();
+        if (!Is<Boolean>(result) || As<Boolean>(result)->GetValue()) {
+            return result;
+        }
+    }
+    return result;
+}
+
+namespace {
+
+// The branch of an if form that its condition selects, null when the else branch is missing.
+std::shared_ptr<Object> SelectBranch(const std::shared_ptr<Object>& head) {
+    auto args = ToArgs(head);
+    if (args.size() < 2 || args.size() > 3) {
+        throw SyntaxError();
+    }
+    for (auto& arg : args) {
+        if (!arg) {
+            throw RuntimeError();
         }
+    }
+    auto condition = args[0]->Eval();
+    if (!Is<Boolean>(condition) || As<Boolean>(condition)->GetValue()) {
+        return args[1];
+    } else if (args.size() == 3) {
+        return args[2];
     } else {
-        return head->Eval();
+        return nullptr;
     }
 }
 
+}  // namespace
+
+std::shared_ptr<Object> If::Apply(std::shared_ptr<Object> head) {
+    auto branch = SelectBranch(head);
+    return branch ? branch->Eval() : nullptr;
+}
+
+std::shared_ptr<Object> If::ApplyTail(std::shared_ptr<Object> head) {
+    auto branch = SelectBranch(head);
+    return branch ? EvalTail(branch) : nullptr;
+}
+
 std::shared_ptr<Object> Quote::Apply(std::shared_ptr<Object> head) {
-    return head;
+    if (!Is<Cell>(head) || As<Cell>(head)->GetSecond()) {
+        throw SyntaxError();
+    }
+    return As<Cell>(head)->GetFirst();
 }
 
 std::shared_ptr<Object> Pair::Apply(std::shared_ptr<Object> head) {
     auto vec = ToVector(As<Cell>(head)->GetFirst()->Eval());
     if (vec.size() == 2) {
-        return std::make_shared<Boolean>(true);
+        return Make<Boolean>(true);
     } else {
-        return std::make_shared<Boolean>(false);
+        return Make<Boolean>(false);
     }
 }
 
 std::shared_ptr<Object> Null::Apply(std::shared_ptr<Object> head) {
-    auto vec = ToVector(As<Cell>(head)->GetFirst()->Eval());
-    if (vec.size() == 0) {
-        return std::make_shared<Boolean>(true);
-    } else {
-        return std::make_shared<Boolean>(false);
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
     }
+    return Make<Boolean>(!args[0]);
 }
 
 std::shared_ptr<Object> ListPredicate::Apply(std::shared_ptr<Object> head) {
     auto cur = As<Cell>(head)->GetFirst()->Eval();
     if (!cur) {
-        return std::make_shared<Boolean>(true);
+        return Make<Boolean>(true);
     }
     while (As<Cell>(cur)->GetSecond() && Is<Cell>(As<Cell>(cur)->GetSecond())) {
         cur = As<Cell>(cur)->GetSecond();
     }
     if (!As<Cell>(cur)->GetSecond()) {
-        return std::make_shared<Boolean>(true);
+        return Make<Boolean>(true);
     } else {
-        return std::make_shared<Boolean>(false);
+        return Make<Boolean>(false);
     }
 }
 
 std::shared_ptr<Object> Cons::Apply(std::shared_ptr<Object> head) {
-    return std::make_shared<Cell>(As<Cell>(head->Eval())->GetFirst(),
-                                  As<Cell>(As<Cell>(head->Eval())->GetSecond())->GetFirst());
+    auto args = EvalArgs(head);
+    if (args.size() != 2) {
+        throw RuntimeError();
+    }
+    return Make<Cell>(args[0], args[1]);
+}
+
+std::shared_ptr<Object> EqualPredicate::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 2) {
+        throw RuntimeError();
+    }
+    return Make<Boolean>(StructuralEqual(args[0], args[1]));
 }
+
 std::shared_ptr<Object> Car::Apply(std::shared_ptr<Object> head) {
-    auto vec = ToVector(head->Eval());
-    if (vec.size() == 0) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1 || !Is<Cell>(args[0])) {
         throw RuntimeError();
     }
-    return As<Number>(vec[0]);
+    return As<Cell>(args[0])->GetFirst();
 }
 std::shared_ptr<Object> Cdr::Apply(std::shared_ptr<Object> head) {
-    auto temp = As<Cell>(head->Eval())->GetFirst();
-    if (!temp) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1 || !Is<Cell>(args[0])) {
+        throw RuntimeError();
+    }
+    return As<Cell>(args[0])->GetSecond();
+}
+
+std::shared_ptr<Object> SetCar::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 2 || !Is<Cell>(args[0])) {
         throw RuntimeError();
     }
-    return As<Cell>(temp)->GetSecond();
+    As<Cell>(args[0])->SetFirst(args[1]);
+    return nullptr;
+}
+
+std::shared_ptr<Object> SetCdr::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 2 || !Is<Cell>(args[0])) {
+        throw RuntimeError();
+    }
+    As<Cell>(args[0])->SetSecond(args[1]);
+    return nullptr;
 }
 
 std::shared_ptr<Object> List::Apply(std::shared_ptr<Object> head) {
-    if (!head) {
-        return nullptr;
+    auto args = EvalArgs(head);
+    std::shared_ptr<Object> result;
+    for (auto it = args.rbegin(); it != args.rend(); ++it) {
+        result = Make<Cell>(*it, result);
     }
-    auto vec = ToVector(head->Eval());
-    auto ans = std::make_shared<Cell>(As<Number>(vec.back()), nullptr);
-    vec.pop_back();
-    while (vec.size() > 0) {
-        ans = std::make_shared<Cell>(As<Number>(vec.back()), ans);
-        vec.pop_back();
+    return result;
+}
+
+// Walks k cells of the list, evaluating the arguments once.
+std::shared_ptr<Object> ListTail(const std::shared_ptr<Object>& head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 2) {
+        throw RuntimeError();
+    }
+    auto cur = args[0];
+    for (int64_t k = GetIndex(args[1]); k > 0; --k) {
+        if (!Is<Cell>(cur)) {
+            throw RuntimeError();
+        }
+        cur = As<Cell>(cur)->GetSecond();
     }
-    return ans;
+    return cur;
 }
 
 std::shared_ptr<Object> Ref::Apply(std::shared_ptr<Object> head) {
-    auto vec = ToVector(As<Cell>(head->Eval())->GetFirst());
-    auto temp = As<Cell>(head->Eval())->GetSecond();
-    if (vec.size() <= As<Number>(As<Cell>(temp)->GetFirst())->GetValue()) {
+    auto cell = ListTail(head);
+    if (!Is<Cell>(cell)) {
         throw RuntimeError();
     }
-    return As<Number>(vec[As<Number>(As<Cell>(temp)->GetFirst())->GetValue()]);
+    return As<Cell>(cell)->GetFirst();
 }
 
 std::shared_ptr<Object> Tail::Apply(std::shared_ptr<Object> head) {
-    auto ans = As<Cell>(head->Eval())->GetFirst();
-    for (int i = 0;
-         i < As<Number>(As<Cell>(As<Cell>(head->Eval())->GetSecond())->GetFirst())->GetValue() - 1;
-         ++i) {
-        if (!As<Cell>(ans)->GetSecond()) {
+    return ListTail(head);
+}
+
+String::String(std::span<const std::string_view> parts) : size_(0) {
+    for (auto part : parts) {
+        size_ += part.size();
+    }
+    char* data = inline_;
+    if (size_ > kInlineSize) {
+        auto buffer = std::allocate_shared<char[]>(HeapAllocator<char>(current_heap, "string buffer"),
+                                                   size_);
+        data = buffer.get();
+        buffer_ = std::move(buffer);
+    }
+    data_ = data;
+    for (auto part : parts) {
+        data = std::copy(part.begin(), part.end(), data);
+    }
+}
+
+String::String(const String& text, size_t start, size_t size) : size_(size) {
+    // Short slices are copied, so they do not keep a long buffer alive.
+    if (size_ > kInlineSize) {
+        buffer_ = text.buffer_;
+        data_ = text.data_ + start;
+    } else {
+        std::copy_n(text.data_ + start, size_, inline_);
+        data_ = inline_;
+    }
+}
+
+std::shared_ptr<String> GetString(const std::shared_ptr<Object>& obj) {
+    if (!Is<String>(obj)) {
+        throw RuntimeError();
+    }
+    return As<String>(obj);
+}
+
+std::shared_ptr<Object> StringPredicate::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    return Make<Boolean>(Is<String>(args[0]));
+}
+
+std::shared_ptr<Object> StringLength::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    return Make<Number>(GetString(args[0])->GetView().size());
+}
+
+std::shared_ptr<Object> Substring::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() < 2 || args.size() > 3) {
+        throw RuntimeError();
+    }
+    auto text = GetString(args[0]);
+    size_t size = text->GetView().size();
+    size_t start = GetIndex(args[1]);
+    size_t end = args.size() == 3 ? GetIndex(args[2]) : size;
+    if (start > end || end > size) {
+        throw RuntimeError();
+    }
+    return Make<String>(*text, start, end - start);
+}
+
+std::shared_ptr<Object> StringAppend::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    std::vector<std::string_view> parts;
+    parts.reserve(args.size());
+    for (const auto& arg : args) {
+        parts.push_back(GetString(arg)->GetView());
+    }
+    return Make<String>(std::span<const std::string_view>(parts));
+}
+
+std::shared_ptr<Object> StringEqual::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.empty()) {
+        throw RuntimeError();
+    }
+    auto first = GetString(args[0])->GetView();
+    bool equal = true;
+    for (size_t i = 1; i < args.size(); ++i) {
+        auto view = GetString(args[i])->GetView();
+        equal = equal && view == first;
+    }
+    return Make<Boolean>(equal);
+}
+
+std::shared_ptr<Object> StringToSymbol::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    return Make<Symbol>(std::string(GetString(args[0])->GetView()));
+}
+
+std::shared_ptr<Object> SymbolToString::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1 || !Is<Symbol>(args[0])) {
+        throw RuntimeError();
+    }
+    return Make<String>(As<Symbol>(args[0])->GetName());
+}
+
+std::shared_ptr<Vector> GetVector(const std::shared_ptr<Object>& obj) {
+    if (!Is<Vector>(obj)) {
+        throw RuntimeError();
+    }
+    return As<Vector>(obj);
+}
+
+std::shared_ptr<Object> MakeVector::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.empty() || args.size() > 2) {
+        throw RuntimeError();
+    }
+    auto fill = args.size() == 2 ? args[1] : Make<Number>(0);
+    return Make<Vector>(
+        std::vector<std::shared_ptr<Object>>(GetIndex(args[0]), fill));
+}
+
+std::shared_ptr<Object> BuildVector::Apply(std::shared_ptr<Object> head) {
+    return Make<Vector>(EvalArgs(head));
+}
+
+std::shared_ptr<Object> VectorRef::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 2) {
+        throw RuntimeError();
+    }
+    auto& elements = GetVector(args[0])->GetElements();
+    auto index = GetIndex(args[1]);
+    if (index >= static_cast<int64_t>(elements.size())) {
+        throw RuntimeError();
+    }
+    return elements[index];
+}
+
+std::shared_ptr<Object> VectorSet::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 3) {
+        throw RuntimeError();
+    }
+    auto& elements = GetVector(args[0])->GetElements();
+    auto index = GetIndex(args[1]);
+    if (index >= static_cast<int64_t>(elements.size())) {
+        throw RuntimeError();
+    }
+    elements[index] = args[2];
+    return nullptr;
+}
+
+std::shared_ptr<Object> VectorLength::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    return Make<Number>(GetVector(args[0])->GetElements().size());
+}
+
+std::shared_ptr<Object> ListToVector::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    std::vector<std::shared_ptr<Object>> elements;
+    for (auto cur = args[0]; cur; cur = As<Cell>(cur)->GetSecond()) {
+        if (!Is<Cell>(cur)) {
+            throw RuntimeError();
+        }
+        elements.push_back(As<Cell>(cur)->GetFirst());
+    }
+    return Make<Vector>(std::move(elements));
+}
+
+std::shared_ptr<Object> VectorToList::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    const auto& elements = GetVector(args[0])->GetElements();
+    std::shared_ptr<Object> result;
+    for (auto it = elements.rbegin(); it != elements.rend(); ++it) {
+        result = Make<Cell>(*it, result);
+    }
+    return result;
+}
+
+std::shared_ptr<Object> MakeClosure(const std::shared_ptr<Object>& params,
+                                    std::vector<std::shared_ptr<Object>> body) {
+    std::vector<std::string> names;
+    for (auto& param : ToArgs(params)) {
+        if (!Is<Symbol>(param)) {
+            throw SyntaxError();
+        }
+        names.push_back(As<Symbol>(param)->GetName());
+    }
+    if (body.empty()) {
+        throw SyntaxError();
+    }
+    return Make<Closure>(std::move(names), std::move(body), current_scope);
+}
+
+std::shared_ptr<Object> Lambda::Apply(std::shared_ptr<Object> head) {
+    auto args = ToArgs(head);
+    if (args.size() < 2) {
+        throw SyntaxError();
+    }
+    return MakeClosure(args[0], {args.begin() + 1, args.end()});
+}
+
+std::shared_ptr<Object> Closure::Apply(std::shared_ptr<Object> head) {
+    return Call(EvalArgs(head));
+}
+
+std::shared_ptr<Object> Closure::ApplyTail(std::shared_ptr<Object> head) {
+    return Make<TailCall>(std::static_pointer_cast<Closure>(shared_from_this()), EvalArgs(head));
+}
+
+std::shared_ptr<Object> Closure::Call(const std::vector<std::shared_ptr<Object>>& args) {
+    return Finish(Enter(args));
+}
+
+std::shared_ptr<Object> Closure::Interpret(const std::vector<std::shared_ptr<Object>>& args) {
+    return Finish(Run(args));
+}
+
+std::shared_ptr<Object> Closure::Enter(const std::vector<std::shared_ptr<Object>>& args) {
+    if (args.size() != params_.size()) {
+        throw RuntimeError();
+    }
+    CallFrame frame(this);
+#ifdef SCHEME_JIT
+    if (!InParallel()) {
+        if (auto result = RunCompiled(this, args)) {
+            return result;
+        }
+    }
+#endif
+    return Run(args);
+}
+
+std::shared_ptr<Object> Closure::Run(const std::vector<std::shared_ptr<Object>>& args) {
+    auto scope = Make<Scope>(scope_);
+    for (size_t i = 0; i < params_.size(); ++i) {
+        scope->Define(params_[i], args[i]);
+    }
+    ScopeGuard guard(scope);
+    for (size_t i = 0; i + 1 < body_.size(); ++i) {
+        if (!body_[i]) {
             throw RuntimeError();
         }
-        ans = As<Cell>(ans)->GetSecond();
+        body_[i]->Eval();
+    }
+    if (!body_.back()) {
+        throw RuntimeError();
+    }
+    return EvalTail(body_.back());
+}
+
+std::shared_ptr<Object> Closure::Finish(std::shared_ptr<Object> result) {
+    while (auto call = dynamic_cast<TailCall*>(result.get())) {
+        result = call->GetClosure()->Enter(call->GetArgs());
+    }
+    return result;
+}
+
+std::shared_ptr<Object> Define::Apply(std::shared_ptr<Object> head) {
+    auto args = ToArgs(head);
+    if (args.size() < 2) {
+        throw SyntaxError();
+    }
+    if (Is<Cell>(args[0]) && Is<Symbol>(As<Cell>(args[0])->GetFirst())) {
+        auto closure =
+            MakeClosure(As<Cell>(args[0])->GetSecond(), {args.begin() + 1, args.end()});
+        auto name = As<Symbol>(As<Cell>(args[0])->GetFirst())->GetName();
+        As<Closure>(closure)->SetName(name);
+        DefineVariable(name, closure);
+        return nullptr;
+    }
+    if (args.size() != 2 || !Is<Symbol>(args[0])) {
+        throw SyntaxError();
+    }
+    if (!args[1]) {
+        throw RuntimeError();
+    }
+    auto value = args[1]->Eval();
+    if (Is<Closure>(value) && As<Closure>(value)->GetName().empty()) {
+        As<Closure>(value)->SetName(As<Symbol>(args[0])->GetName());
+    }
+    DefineVariable(As<Symbol>(args[0])->GetName(), value);
+    return nullptr;
+}
+
+std::shared_ptr<Object> Set::Apply(std::shared_ptr<Object> head) {
+    auto args = ToArgs(head);
+    if (args.size() != 2 || !Is<Symbol>(args[0])) {
+        throw SyntaxError();
+    }
+    auto symbol = As<Symbol>(args[0]);
+    if (!symbol->Resolve()) {
+        throw NameError();
+    }
+    if (!args[1]) {
+        throw RuntimeError();
+    }
+    auto value = args[1]->Eval();
+    bool is_global = false;
+    auto binding = symbol->Resolve(&is_global);
+    if (is_global) {
+        SetGlobal(symbol->GetName(), value);
+    } else {
+        binding->value = value;
     }
-    return As<Cell>(ans)->GetSecond();
+    return nullptr;
 }
@@ -1,12 +1,17 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
+#include <shared_mutex>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include "error.h"
+#include "heap.h"
 
 class Object : public std::enable_shared_from_this<Object> {
 public:
@@ -27,10 +32,10 @@ public:
     }
 
     std::shared_ptr<Object> Eval() override {
-        return std::make_shared<Number>(value_);
+        return Make<Number>(value_);
     }
 
-    int GetValue() const {
+    int64_t GetValue() const {
         return value_;
     }
 
@@ -38,6 +43,69 @@ private:
     int64_t value_;
 };
 
+// Slot of a global variable. Slots are never removed, so pointers to them stay valid and are
+// cached by symbols and call sites until the global version changes.
+struct Binding {
+    std::shared_ptr<Object> value;
+};
+
+// Global variables of one interpreter. Every Interpreter owns an environment and installs it
+// for the thread running it; nothing else in the evaluator is shared between interpreters
+// except the builtins, which are immutable. Threads running no interpreter see a sealed
+// environment holding only the builtins.
+class Environment {
+public:
+    Environment();
+
+    Binding* Find(const std::string& name);
+
+    void Define(const std::string& name, std::shared_ptr<Object> value);
+
+    void Set(const std::string& name, std::shared_ptr<Object> value);
+
+    // Bumped whenever a slot is created or rebound. Versions of different environments never
+    // coincide, so a cache filled in one environment is never trusted in another.
+    uint64_t GetVersion() const {
+        return version_.load(std::memory_order_relaxed);
+    }
+
+    void Invalidate() {
+        version_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Seal() {
+        sealed_ = true;
+    }
+
+    std::vector<std::pair<std::string, std::shared_ptr<Object>>> GetBindings();
+
+private:
+    std::unordered_map<std::string, Binding> globals_;
+    // Only taken on cache misses and definitions, which may come from pool workers.
+    std::shared_mutex mutex_;
+    bool sealed_ = false;
+    // Kept on its own cache line, since every call site reads it.
+    alignas(64) std::atomic<uint64_t> version_;
+};
+
+Environment* CurrentEnvironment();
+
+class EnvironmentGuard {
+public:
+    EnvironmentGuard(Environment* environment);
+
+    ~EnvironmentGuard();
+
+private:
+    Environment* saved_;
+};
+
+Binding* FindBinding(const std::string& name);
+
+void DefineGlobal(const std::string& name, std::shared_ptr<Object> value);
+
+void SetGlobal(const std::string& name, std::shared_ptr<Object> value);
+
 class Symbol : public Object {
 public:
     Symbol(const std::string& value) : value_(value) {
@@ -49,8 +117,52 @@ public:
         return value_;
     }
 
+    // Finds the slot of the name in the current local scopes or among globals. Only global slots
+    // are cached; local defines bump the global version so a cached slot is never shadowed.
+    Binding* Resolve(bool* is_global = nullptr);
+
 private:
     const std::string value_;
+    Binding* binding_ = nullptr;
+    uint64_t version_ = 0;
+};
+
+// Immutable text. Short strings are stored in the object itself; longer ones live in a buffer
+// charged to the heap, which substrings share instead of copying.
+class String : public Object {
+public:
+    static constexpr size_t kInlineSize = 15;
+
+    explicit String(std::string_view text) : String(std::span(&text, 1)) {
+    }
+
+    // The concatenation of the parts, copied once.
+    explicit String(std::span<const std::string_view> parts);
+
+    // The `size` characters of `text` from `start` on.
+    String(const String& text, size_t start, size_t size);
+
+    String(const String&) = delete;
+    String& operator=(const String&) = delete;
+
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+
+    std::string_view GetView() const {
+        return {data_, size_};
+    }
+
+    // Whether the text is held by the object rather than a shared buffer.
+    bool IsInline() const {
+        return !buffer_;
+    }
+
+private:
+    size_t size_;
+    const char* data_;
+    std::shared_ptr<const char[]> buffer_;
+    char inline_[kInlineSize];
 };
 
 class Boolean : public Object {
@@ -68,7 +180,36 @@ private:
     bool value_;
 };
 
-class Function : public Object {};
+class Function : public Object {
+public:
+    // Calls the function on already evaluated arguments.
+    virtual std::shared_ptr<Object> Call(const std::vector<std::shared_ptr<Object>>& args);
+
+    // Apply for a form in tail position of a closure body. Calls of closures are returned as a
+    // TailCall there instead of being made.
+    virtual std::shared_ptr<Object> ApplyTail(std::shared_ptr<Object> head) {
+        return Apply(head);
+    }
+
+    // Index of the function in the call counters: its builtin slot, zero for other functions.
+    uint32_t GetCallSlot() const {
+        return call_slot_;
+    }
+    void SetCallSlot(uint32_t slot) {
+        call_slot_ = slot;
+    }
+
+private:
+    uint32_t call_slot_ = 0;
+};
+
+// Builtin over fixnums. Arguments are gathered into a contiguous buffer before the call.
+class NumericFunction : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+
+    virtual std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) = 0;
+};
 
 class BooleanPredicate : public Function {
 public:
@@ -110,6 +251,16 @@ public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
+class SetCar : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class SetCdr : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
 class List : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
@@ -125,62 +276,165 @@ public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Sum : public Function {
+class EqualPredicate : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Sub : public Function {
+class Vector : public Object {
+public:
+    // The element buffer is charged to the interpreter's heap, like the objects themselves.
+    using Elements = std::vector<std::shared_ptr<Object>, HeapAllocator<std::shared_ptr<Object>>>;
+
+    Vector(std::vector<std::shared_ptr<Object>> elements)
+        : elements_(std::make_move_iterator(elements.begin()),
+                    std::make_move_iterator(elements.end()),
+                    HeapAllocator<std::shared_ptr<Object>>(current_heap, "vector buffer")) {
+    }
+
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+
+    Elements& GetElements() {
+        return elements_;
+    }
+
+private:
+    Elements elements_;
+};
+
+class StringPredicate : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Mul : public Function {
+class StringLength : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Div : public Function {
+class Substring : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Equ : public Function {
+class StringAppend : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Les : public Function {
+class StringEqual : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Gre : public Function {
+class StringToSymbol : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Loe : public Function {
+class SymbolToString : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Goe : public Function {
+class MakeVector : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Min : public Function {
+class BuildVector : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Max : public Function {
+class VectorRef : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
-class Abs : public Function {
+class VectorSet : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class VectorLength : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class ListToVector : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class VectorToList : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class Sum : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Sub : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Mul : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Div : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Equ : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Les : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Gre : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Loe : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Goe : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Min : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Max : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class Abs : public NumericFunction {
+public:
+    std::shared_ptr<Object> Compute(const std::vector<int64_t>& args) override;
+};
+
+class ApplyList : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
@@ -200,6 +454,28 @@ public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
 };
 
+class If : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+
+    std::shared_ptr<Object> ApplyTail(std::shared_ptr<Object> head) override;
+};
+
+class Define : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class Set : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class Lambda : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
 class Quote : public Function {
 public:
     std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
@@ -211,8 +487,16 @@ public:
         : first_(first), second_(second) {
     }
 
+    // Frees the rest of a list that nothing else holds one pair at a time, so that dropping a
+    // long list does not recurse once per pair.
+    ~Cell() override;
+
     std::shared_ptr<Object> Eval() override;
 
+    // Eval that also tells whether the head was applied as a procedure, rather than the cell
+    // evaluated as a list of data. A form in tail position is applied with ApplyTail.
+    std::shared_ptr<Object> EvalForm(bool* applied, bool tail = false);
+
     std::shared_ptr<Object> GetFirst() const {
         return first_;
     }
@@ -220,8 +504,132 @@ public:
         return second_;
     }
 
+    void SetFirst(std::shared_ptr<Object> first) {
+        first_ = std::move(first);
+        callee_version_ = 0;
+    }
+    void SetSecond(std::shared_ptr<Object> second) {
+        second_ = std::move(second);
+    }
+
 private:
     std::shared_ptr<Object> first_, second_;
+    Binding* callee_ = nullptr;
+    uint64_t callee_version_ = 0;
+};
+
+class Scope {
+public:
+    Scope(std::shared_ptr<Scope> parent) : parent_(parent) {
+    }
+
+    Binding* Find(const std::string& name);
+
+    void Define(const std::string& name, std::shared_ptr<Object> value);
+
+    const std::unordered_map<std::string, Binding>& GetVariables() const {
+        return variables_;
+    }
+    const std::shared_ptr<Scope>& GetParent() const {
+        return parent_;
+    }
+
+private:
+    std::unordered_map<std::string, Binding> variables_;
+    std::shared_ptr<Scope> parent_;
+};
+
+// Installs the innermost local scope for the current thread.
+class ScopeGuard {
+public:
+    ScopeGuard(std::shared_ptr<Scope> scope);
+
+    ~ScopeGuard();
+
+private:
+    std::shared_ptr<Scope> saved_;
+};
+
+class CompiledLambda;
+
+struct JitState {
+    uint32_t calls = 0;
+    uint32_t deopts = 0;
+    bool failed = false;
+    std::shared_ptr<CompiledLambda> code;
+};
+
+class Closure : public Function {
+public:
+    Closure(std::vector<std::string> params, std::vector<std::shared_ptr<Object>> body,
+            std::shared_ptr<Scope> scope)
+        : params_(std::move(params)), body_(std::move(body)), scope_(scope) {
+    }
+
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+
+    std::shared_ptr<Object> ApplyTail(std::shared_ptr<Object> head) override;
+
+    std::shared_ptr<Object> Call(const std::vector<std::shared_ptr<Object>>& args) override;
+
+    // Call that never runs compiled code for this closure.
+    std::shared_ptr<Object> Interpret(const std::vector<std::shared_ptr<Object>>& args);
+
+    const std::vector<std::string>& GetParams() const {
+        return params_;
+    }
+    const std::vector<std::shared_ptr<Object>>& GetBody() const {
+        return body_;
+    }
+    const std::shared_ptr<Scope>& GetScope() const {
+        return scope_;
+    }
+    JitState& GetJitState() {
+        return jit_state_;
+    }
+    // Name of the variable the closure was first defined as, empty for anonymous ones.
+    const std::string& GetName() const {
+        return name_;
+    }
+    void SetName(std::string name) {
+        name_ = std::move(name);
+    }
+
+private:
+    // Call that returns the call in tail position of the body as a TailCall instead of making
+    // it, so that its frame is gone by then.
+    std::shared_ptr<Object> Enter(const std::vector<std::shared_ptr<Object>>& args);
+
+    std::shared_ptr<Object> Run(const std::vector<std::shared_ptr<Object>>& args);
+
+    // Makes the tail calls `result` leads to, one after another.
+    static std::shared_ptr<Object> Finish(std::shared_ptr<Object> result);
+
+    std::vector<std::string> params_;
+    std::vector<std::shared_ptr<Object>> body_;
+    std::shared_ptr<Scope> scope_;
+    JitState jit_state_;
+    std::string name_;
+};
+
+// Call of a closure in tail position of another closure's body, made by the Closure::Call the
+// body runs in.
+class TailCall : public Object {
+public:
+    TailCall(std::shared_ptr<Closure> closure, std::vector<std::shared_ptr<Object>> args)
+        : closure_(std::move(closure)), args_(std::move(args)) {
+    }
+
+    const std::shared_ptr<Closure>& GetClosure() const {
+        return closure_;
+    }
+    const std::vector<std::shared_ptr<Object>>& GetArgs() const {
+        return args_;
+    }
+
+private:
+    std::shared_ptr<Closure> closure_;
+    std::vector<std::shared_ptr<Object>> args_;
 };
 
 template <class T>
@@ -244,8 +652,26 @@ std::shared_ptr<T> As(const std::shared_ptr<Object>& obj) {
 
 std::vector<std::shared_ptr<Object>> ToVector(const std::shared_ptr<Object>&);
 
-template <class T>
-void ValidateArgsType(std::vector<std::shared_ptr<Object>>);
+std::vector<std::shared_ptr<Object>> ToArgs(const std::shared_ptr<Object>&);
+
+std::vector<std::shared_ptr<Object>> EvalArgs(const std::shared_ptr<Object>&);
+
+// Evaluates an expression in tail position of a closure body. May return a TailCall.
+std::shared_ptr<Object> EvalTail(const std::shared_ptr<Object>&);
+
+std::vector<int64_t> GatherNumbers(const std::shared_ptr<Object>&);
+
+const std::unordered_map<std::string, std::shared_ptr<Function>>& GetBuiltins();
+
+// Names of the builtins by call slot, starting at slot 1.
+const std::vector<std::string>& GetCallSlotNames();
+
+std::shared_ptr<Object> MakeClosure(const std::shared_ptr<Object>& params,
+                                    std::vector<std::shared_ptr<Object>> body);
+
+void DefineVariable(const std::string& name, std::shared_ptr<Object> value);
+
+// Hash and equality that follow the structure of lists and vectors, as equal? does.
+size_t StructuralHash(const std::shared_ptr<Object>& obj);
 
-template <class Result, class T, class F, class It>
-std::shared_ptr<Result> Fold(It, It, T, F);
+bool StructuralEqual(const std::shared_ptr<Object>& lhs, const std::shared_ptr<Object>& rhs);
@@ -0,0 +1,235 @@
+#include "optimizer.h"
+
+#include <unordered_set>
+
+#include "memoize.h"
+#include "parallel.h"
+#include "stream.h"
+
+namespace {
+
+using Names = std::unordered_set<std::string>;
+
+bool IsConstant(const std::shared_ptr<Object>& obj) {
+    if (Is<Number>(obj) || Is<Boolean>(obj) || Is<String>(obj)) {
+        return true;
+    } else if (Is<Symbol>(obj)) {
+        return As<Symbol>(obj)->GetName() == "#t" || As<Symbol>(obj)->GetName() == "#f";
+    } else {
+        return false;
+    }
+}
+
+bool IsFalse(const std::shared_ptr<Object>& obj) {
+    if (Is<Boolean>(obj)) {
+        return !As<Boolean>(obj)->GetValue();
+    } else if (Is<Symbol>(obj)) {
+        return As<Symbol>(obj)->GetName() == "#f";
+    } else {
+        return false;
+    }
+}
+
+bool IsFoldable(const std::shared_ptr<Function>& function) {
+    return Is<Sum>(function) || Is<Sub>(function) || Is<Mul>(function) || Is<Equ>(function) ||
+           Is<Les>(function) || Is<Gre>(function) || Is<Loe>(function) || Is<Goe>(function) ||
+           Is<Min>(function) || Is<Max>(function) || Is<Abs>(function) || Is<Not>(function);
+}
+
+// Bodies of closures and delayed expressions run after later forms may have rebound the
+// builtins they call, so they are left as written.
+bool Defers(const std::shared_ptr<Function>& function, const std::shared_ptr<Object>& args) {
+    if (Is<Define>(function)) {
+        return Is<Cell>(args) && Is<Cell>(As<Cell>(args)->GetFirst());
+    }
+    return Is<Lambda>(function) || Is<DefineMemoized>(function) || Is<Delay>(function) ||
+           Is<ConsStream>(function) || Is<MakeFuture>(function);
+}
+
+void CollectRebound(const std::shared_ptr<Object>& obj, Names* rebound) {
+    if (!Is<Cell>(obj)) {
+        return;
+    }
+    auto head = As<Cell>(obj)->GetFirst();
+    if (Is<Symbol>(head) && As<Symbol>(head)->GetName() == "quote") {
+        return;
+    }
+    if (Is<Symbol>(head) &&
+        (As<Symbol>(head)->GetName() == "define" || As<Symbol>(head)->GetName() == "set!" ||
+         As<Symbol>(head)->GetName() == "lambda" ||
+         As<Symbol>(head)->GetName() == "define-memoized") &&
+        Is<Cell>(As<Cell>(obj)->GetSecond())) {
+        // Names bound by define, set!, lambda and define-memoized, including parameter lists.
+        auto target = As<Cell>(As<Cell>(obj)->GetSecond())->GetFirst();
+        if (Is<Symbol>(target)) {
+            rebound->insert(As<Symbol>(target)->GetName());
+        }
+        while (Is<Cell>(target)) {
+            if (Is<Symbol>(As<Cell>(target)->GetFirst())) {
+                rebound->insert(As<Symbol>(As<Cell>(target)->GetFirst())->GetName());
+            }
+            target = As<Cell>(target)->GetSecond();
+        }
+    }
+    CollectRebound(head, rebound);
+    CollectRebound(As<Cell>(obj)->GetSecond(), rebound);
+}
+
+std::shared_ptr<Function> Resolve(const std::shared_ptr<Object>& obj, const Names& rebound) {
+    if (!Is<Symbol>(obj) || rebound.contains(As<Symbol>(obj)->GetName())) {
+        return nullptr;
+    }
+    try {
+        return As<Function>(obj->Eval());
+    } catch (const std::runtime_error&) {
+        return nullptr;
+    }
+}
+
+std::shared_ptr<Object> MakeList(const std::vector<std::shared_ptr<Object>>& items) {
+    std::shared_ptr<Object> result;
+    for (auto it = items.rbegin(); it != items.rend(); ++it) {
+        result = Make<Cell>(*it, result);
+    }
+    return result;
+}
+
+bool AllConstant(std::shared_ptr<Object> args) {
+    while (args) {
+        if (!Is<Cell>(args) || !IsConstant(As<Cell>(args)->GetFirst())) {
+            return false;
+        }
+        args = As<Cell>(args)->GetSecond();
+    }
+    return true;
+}
+
+std::shared_ptr<Object> Quoted(const std::shared_ptr<Object>& obj, const Names& rebound) {
+    auto quote = Make<Symbol>("quote");
+    if (!Is<Quote>(Resolve(quote, rebound))) {
+        return nullptr;
+    }
+    return Make<Cell>(quote, Make<Cell>(obj, nullptr));
+}
+
+class Simplifier {
+public:
+    Simplifier(Names rebound) : rebound_(std::move(rebound)) {
+    }
+
+    std::shared_ptr<Object> Simplify(const std::shared_ptr<Object>& obj) {
+        if (!Is<Cell>(obj)) {
+            return obj;
+        }
+        auto head = As<Cell>(obj)->GetFirst();
+        auto function = Resolve(head, rebound_);
+        if (Is<Quote>(function) || Defers(function, As<Cell>(obj)->GetSecond())) {
+            return obj;
+        }
+        auto new_head = Simplify(head);
+        auto args = SimplifyArgs(As<Cell>(obj)->GetSecond());
+        if (Is<If>(function)) {
+            if (auto branch = SimplifyIf(args)) {
+                return branch;
+            }
+        } else if (Is<And>(function) || Is<Or>(function)) {
+            if (auto result = SimplifyLogic(&args, Is<And>(function))) {
+                return result;
+            }
+        } else if (function && IsFoldable(function) && AllConstant(args)) {
+            try {
+                auto result = function->Apply(args);
+                if (Is<Number>(result) || Is<Boolean>(result)) {
+                    return result;
+                }
+            } catch (const std::runtime_error&) {
+            }
+        }
+        if (new_head == head && args == As<Cell>(obj)->GetSecond()) {
+            return obj;
+        }
+        return Make<Cell>(new_head, args);
+    }
+
+private:
+    std::shared_ptr<Object> SimplifyArgs(const std::shared_ptr<Object>& args) {
+        if (!Is<Cell>(args)) {
+            return args;
+        }
+        auto first = As<Cell>(args)->GetFirst();
+        auto second = As<Cell>(args)->GetSecond();
+        auto new_first = Simplify(first);
+        auto new_second = SimplifyArgs(second);
+        if (new_first == first && new_second == second) {
+            return args;
+        }
+        return Make<Cell>(new_first, new_second);
+    }
+
+    // Result of a pruned `if` may replace the whole form only when it is evaluated the same way
+    // outside of it, so the branch must be a constant or a call of a known function.
+    bool IsStandalone(const std::shared_ptr<Object>& obj) {
+        if (IsConstant(obj)) {
+            return true;
+        }
+        return Is<Cell>(obj) && Resolve(As<Cell>(obj)->GetFirst(), rebound_);
+    }
+
+    std::shared_ptr<Object> SimplifyIf(const std::shared_ptr<Object>& args) {
+        std::vector<std::shared_ptr<Object>> items;
+        try {
+            items = ToArgs(args);
+        } catch (const SyntaxError&) {
+            return nullptr;
+        }
+        if (items.size() < 2 || items.size() > 3 || !IsConstant(items[0])) {
+            return nullptr;
+        }
+        if (!IsFalse(items[0])) {
+            return IsStandalone(items[1]) ? items[1] : nullptr;
+        } else if (items.size() == 3) {
+            return IsStandalone(items[2]) ? items[2] : nullptr;
+        } else {
+            return Quoted(nullptr, rebound_);
+        }
+    }
+
+    // Drops constants that cannot decide the result and cuts the tail after one that does.
+    std::shared_ptr<Object> SimplifyLogic(std::shared_ptr<Object>* args, bool is_and) {
+        std::vector<std::shared_ptr<Object>> items;
+        try {
+            items = ToArgs(*args);
+        } catch (const SyntaxError&) {
+            return nullptr;
+        }
+        std::vector<std::shared_ptr<Object>> kept;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (IsConstant(items[i])) {
+                if (IsFalse(items[i]) == is_and) {
+                    kept.push_back(items[i]);
+                    break;
+                } else if (i + 1 < items.size()) {
+                    continue;
+                }
+            }
+            kept.push_back(items[i]);
+        }
+        if (kept.size() == 1 && IsConstant(kept[0])) {
+            return kept[0];
+        }
+        if (kept.size() != items.size()) {
+            *args = MakeList(kept);
+        }
+        return nullptr;
+    }
+
+    Names rebound_;
+};
+
+}  // namespace
+
+std::shared_ptr<Object> Optimize(std::shared_ptr<Object> obj) {
+    Names rebound;
+    CollectRebound(obj, &rebound);
+    return Simplifier(std::move(rebound)).Simplify(obj);
+}
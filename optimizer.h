@@ -0,0 +1,11 @@
+#pragma once
+
+#include <memory>
+
+#include "object.h"
+
+// Folds calls to pure builtins that return numbers or booleans when their arguments are
+// constants, and prunes `if`, `and` and `or` whose outcome is decided by constants. Names
+// rebound anywhere in the form are never folded, and bodies of lambdas, defined procedures and
+// delayed expressions are left alone.
+std::shared_ptr<Object> Optimize(std::shared_ptr<Object> obj);
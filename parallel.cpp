@@ -0,0 +1,263 @@
+#include "parallel.h"
+#include "budget.h"
+#include "profile.h"
+#include "sampler.h"
+#include "stats.h"
+
+namespace {
+
+thread_local TaskPool* current_pool = nullptr;
+thread_local TaskPool* worker_pool = nullptr;
+thread_local size_t worker_index = 0;
+
+std::vector<std::shared_ptr<Object>> ListToValues(const std::shared_ptr<Object>& list) {
+    std::vector<std::shared_ptr<Object>> values;
+    for (auto cur = list; cur; cur = As<Cell>(cur)->GetSecond()) {
+        if (!Is<Cell>(cur)) {
+            throw RuntimeError();
+        }
+        values.push_back(As<Cell>(cur)->GetFirst());
+    }
+    return values;
+}
+
+}  // namespace
+
+TaskPool::TaskPool(size_t workers) : workers_(workers) {
+    for (size_t i = 0; i <= workers_; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void TaskPool::Start() {
+    std::call_once(started_, [this] {
+        for (size_t i = 0; i < workers_; ++i) {
+            threads_.emplace_back([this, i] { WorkerLoop(i); });
+        }
+    });
+}
+
+void TaskPool::Submit(Task run, Task done) {
+    active_.fetch_add(1, std::memory_order_acq_rel);
+    // The task runs under the limits of the submitting program and is sampled as part of it.
+    std::vector<const Function*> frames;
+    if (call_stack) {
+        frames = *call_stack;
+    }
+    Task task = [this, environment = CurrentEnvironment(), heap = current_heap,
+                 site = allocation_site, stats = current_stats, share = ShareBudget(),
+                 sampler = CurrentSampler(), frames = std::move(frames), run = std::move(run),
+                 done = std::move(done)] {
+        {
+            EnvironmentGuard guard(environment);
+            HeapGuard heap_guard(heap);
+            AllocationSiteGuard site_guard(site);
+            StatsGuard stats_guard(stats);
+            TaskBudgetGuard budget_guard(share);
+            SamplingGuard sampling_guard(sampler, frames);
+            run();
+        }
+        active_.fetch_sub(1, std::memory_order_acq_rel);
+        done();
+    };
+    if (!workers_) {
+        task();
+        return;
+    }
+    Start();
+    auto& queue = *queues_[worker_pool == this ? worker_index : workers_];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    pending_.fetch_add(1, std::memory_order_release);
+    // Taking the lock orders the notification after a worker that is about to sleep has
+    // checked pending_.
+    { std::lock_guard lock(mutex_); }
+    wake_.notify_one();
+}
+
+bool TaskPool::TakeTask(size_t index, Task* task) {
+    if (index < workers_) {
+        auto& own = *queues_[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            *task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+    for (size_t i = 1; i <= queues_.size(); ++i) {
+        auto& victim = *queues_[(index + i) % queues_.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            *task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskPool::RunPending() {
+    if (!pending_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    Task task;
+    if (!TakeTask(worker_pool == this ? worker_index : workers_, &task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void TaskPool::WorkerLoop(size_t index) {
+    current_pool = this;
+    worker_pool = this;
+    worker_index = index;
+    while (true) {
+        Task task;
+        if (TakeTask(index, &task)) {
+            task();
+            continue;
+        }
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this] { return stop_ || pending_.load(std::memory_order_acquire); });
+        if (stop_ && !pending_.load(std::memory_order_acquire)) {
+            return;
+        }
+    }
+}
+
+TaskPool* CurrentPool() {
+    return current_pool;
+}
+
+PoolGuard::PoolGuard(TaskPool* pool) : saved_(current_pool) {
+    current_pool = pool;
+}
+
+PoolGuard::~PoolGuard() {
+    current_pool = saved_;
+}
+
+bool InParallel() {
+    return current_pool && current_pool->IsBusy();
+}
+
+std::shared_ptr<Object> Future::Touch() {
+    while (!done_.load(std::memory_order_acquire)) {
+        auto pool = CurrentPool();
+        if (!pool || !pool->RunPending()) {
+            std::this_thread::yield();
+        }
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    return value_;
+}
+
+void Future::SetValue(std::shared_ptr<Object> value, std::exception_ptr error) {
+    value_ = std::move(value);
+    error_ = std::move(error);
+}
+
+std::shared_ptr<Object> MakeFuture::Apply(std::shared_ptr<Object> head) {
+    auto args = ToArgs(head);
+    if (args.size() != 1 || !args[0]) {
+        throw SyntaxError();
+    }
+    auto thunk = As<Function>(MakeClosure(nullptr, {args[0]}));
+    auto future = Make<Future>();
+    auto run = [future, thunk] {
+        try {
+            future->SetValue(thunk->Call({}), nullptr);
+        } catch (...) {
+            future->SetValue(nullptr, std::current_exception());
+        }
+    };
+    auto pool = CurrentPool();
+    if (!pool) {
+        run();
+        future->Resolve();
+    } else {
+        pool->Submit(std::move(run), [future] { future->Resolve(); });
+    }
+    return future;
+}
+
+std::shared_ptr<Object> Touch::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    if (!Is<Future>(args[0])) {
+        return args[0];
+    }
+    return As<Future>(args[0])->Touch();
+}
+
+std::shared_ptr<Object> ParallelMap::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 2 || !Is<Function>(args[0])) {
+        throw RuntimeError();
+    }
+    auto function = As<Function>(args[0]);
+    auto values = ListToValues(args[1]);
+    auto pool = CurrentPool();
+    if (!pool || !pool->GetWorkerCount() || values.size() < pool->GetGrain()) {
+        for (auto& value : values) {
+            value = function->Call({value});
+        }
+    } else {
+        size_t chunk = std::max(pool->GetGrain(),
+                                (values.size() + 4 * pool->GetWorkerCount() - 1) /
+                                    (4 * pool->GetWorkerCount()));
+        std::atomic<size_t> remaining = (values.size() + chunk - 1) / chunk;
+        std::mutex mutex;
+        std::exception_ptr error;
+        for (size_t begin = 0; begin < values.size(); begin += chunk) {
+            size_t end = std::min(values.size(), begin + chunk);
+            auto run = [&, begin, end] {
+                try {
+                    for (size_t i = begin; i < end; ++i) {
+                        values[i] = function->Call({values[i]});
+                    }
+                } catch (...) {
+                    std::lock_guard lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            };
+            pool->Submit(run, [&] { remaining.fetch_sub(1, std::memory_order_release); });
+        }
+        while (remaining.load(std::memory_order_acquire)) {
+            if (!pool->RunPending()) {
+                std::this_thread::yield();
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    std::shared_ptr<Object> result;
+    for (auto it = values.rbegin(); it != values.rend(); ++it) {
+        result = Make<Cell>(*it, result);
+    }
+    return result;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "object.h"
+
+// Work-stealing pool behind pmap and future. Every worker owns a deque: it pushes and pops
+// at the back and steals from the front of the others. Tasks submitted from outside the pool
+// go to a shared injection queue. Threads are started on the first submitted task, and a
+// thread waiting for a result runs pending tasks instead of blocking.
+class TaskPool {
+public:
+    using Task = std::function<void()>;
+
+    static constexpr size_t kDefaultGrain = 64;
+
+    explicit TaskPool(size_t workers);
+
+    ~TaskPool();
+
+    // Runs `run` on the pool and then `done`. InParallel() holds while `run` is running, so
+    // results should be published from `done`.
+    void Submit(Task run, Task done);
+
+    // Runs one pending task on the calling thread. Returns false when there is none.
+    bool RunPending();
+
+    size_t GetWorkerCount() const {
+        return workers_;
+    }
+
+    // Lists shorter than the grain are mapped sequentially, and no task gets fewer elements.
+    size_t GetGrain() const {
+        return grain_;
+    }
+
+    void SetGrain(size_t grain) {
+        grain_ = grain ? grain : 1;
+    }
+
+    // True from the submission of a task until it has run.
+    bool IsBusy() const {
+        return active_.load(std::memory_order_acquire) > 0;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void Start();
+    void WorkerLoop(size_t index);
+    bool TakeTask(size_t index, Task* task);
+
+    size_t workers_;
+    size_t grain_ = kDefaultGrain;
+    // One queue per worker, then the injection queue.
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::once_flag started_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> pending_ = 0;
+    std::atomic<size_t> active_ = 0;
+    bool stop_ = false;
+};
+
+// Pool of the interpreter running on this thread.
+TaskPool* CurrentPool();
+
+class PoolGuard {
+public:
+    PoolGuard(TaskPool* pool);
+
+    ~PoolGuard();
+
+private:
+    TaskPool* saved_;
+};
+
+// True while tasks are running on the current pool. Global bindings are frozen, and inline caches and
+// tier-up are left alone, for as long as this holds.
+bool InParallel();
+
+class Future : public Object {
+public:
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+
+    // Waits for the value, helping the pool in the meantime. Rethrows the error of the task.
+    std::shared_ptr<Object> Touch();
+
+    void SetValue(std::shared_ptr<Object> value, std::exception_ptr error);
+
+    void Resolve() {
+        done_.store(true, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> done_ = false;
+    std::shared_ptr<Object> value_;
+    std::exception_ptr error_;
+};
+
+class MakeFuture : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class Touch : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class ParallelMap : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
@@ -1,52 +1,122 @@
 #include "parser.h"
+#include "budget.h"
+
+namespace {
+
+Status SyntaxErrorAt(Tokenizer* tokenizer) {
+    return {ErrorKind::SYNTAX, tokenizer->GetOffset()};
+}
+
+// Counts a level of nesting like DepthGuard, but leaves reporting the limit to the reader.
+class ReadDepth {
+public:
+    ReadDepth() : exceeded_(++budget.depth > budget.max_depth) {
+    }
+
+    ~ReadDepth() {
+        --budget.depth;
+    }
+
+    bool Exceeded() const {
+        return exceeded_;
+    }
+
+private:
+    bool exceeded_;
+};
+
+std::shared_ptr<Object> ThrowOnError(Result<std::shared_ptr<Object>> result,
+                                     Tokenizer* tokenizer) {
+    if (!result) {
+        ThrowError(result.error);
+    } else if (tokenizer->HasFailed()) {
+        throw SyntaxError();
+    }
+    return std::move(result.value);
+}
+
+}  // namespace
 
 std::shared_ptr<Object> Read(Tokenizer* tokenizer) {
+    return ThrowOnError(TryRead(tokenizer), tokenizer);
+}
+
+std::shared_ptr<Object> ReadList(Tokenizer* tokenizer) {
+    return ThrowOnError(TryReadList(tokenizer), tokenizer);
+}
+
+Result<std::shared_ptr<Object>> TryRead(Tokenizer* tokenizer) {
+    if (tokenizer->HasFailed() || tokenizer->IsEnd()) {
+        return SyntaxErrorAt(tokenizer);
+    }
     Token cur_token = tokenizer->GetToken();
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError();
-    } else if (cur_token.index() == 0) {
-        tokenizer->Next();
-        return std::make_shared<Number>(std::get<ConstantToken>(cur_token).value_);
+    if (cur_token.index() == 0) {
+        tokenizer->TryNext();
+        return Make<Number>(std::get<ConstantToken>(cur_token).value_);
     } else if (cur_token == Token{BracketToken::OPEN}) {
-        tokenizer->Next();
-        return ReadList(tokenizer);
+        ReadDepth depth;
+        if (depth.Exceeded()) {
+            return Status{ErrorKind::LIMIT, tokenizer->GetOffset()};
+        }
+        tokenizer->TryNext();
+        return TryReadList(tokenizer);
     } else if (cur_token.index() == 2) {
-        tokenizer->Next();
-        return std::make_shared<Symbol>(std::get<SymbolToken>(cur_token).name_);
+        tokenizer->TryNext();
+        return Make<Symbol>(std::get<SymbolToken>(cur_token).name_);
+    } else if (cur_token.index() == 5) {
+        tokenizer->TryNext();
+        return Make<String>(std::get<StringToken>(cur_token).value_);
     } else if (cur_token.index() == 3) {
-        tokenizer->Next();
-        return std::make_shared<Cell>(std::make_shared<Symbol>("quote"), Read(tokenizer));
+        ReadDepth depth;
+        if (depth.Exceeded()) {
+            return Status{ErrorKind::LIMIT, tokenizer->GetOffset()};
+        }
+        tokenizer->TryNext();
+        auto datum = TryRead(tokenizer);
+        if (!datum) {
+            return datum;
+        }
+        return Make<Cell>(Make<Symbol>("quote"), Make<Cell>(std::move(datum.value), nullptr));
     } else {
-        throw SyntaxError();
+        return SyntaxErrorAt(tokenizer);
     }
 }
 
-std::shared_ptr<Object> ReadList(Tokenizer* tokenizer) {
-    if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {
-        tokenizer->Next();
-        return nullptr;
-    }
-    auto first = Read(tokenizer);
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError();
-    }
-    if (tokenizer->GetToken().index() == 0) {
-        return std::make_shared<Cell>(first, ReadList(tokenizer));
-    } else if (tokenizer->GetToken().index() == 1) {
-        return std::make_shared<Cell>(first, ReadList(tokenizer));
-    } else if (tokenizer->GetToken().index() == 2) {
-        return std::make_shared<Cell>(first, ReadList(tokenizer));
-    } else if (tokenizer->GetToken().index() == 3) {
-        return std::make_shared<Cell>(first, ReadList(tokenizer));
-    } else if (tokenizer->GetToken().index() == 4) {
-        tokenizer->Next();
-        auto second = Read(tokenizer);
-        if (tokenizer->GetToken() != Token{BracketToken::CLOSE} || tokenizer->IsEnd()) {
-            throw SyntaxError();
+Result<std::shared_ptr<Object>> TryReadList(Tokenizer* tokenizer) {
+    // Elements are collected first, so long lists do not use up the stack.
+    std::vector<std::shared_ptr<Object>> elements;
+    std::shared_ptr<Object> result;
+    while (true) {
+        if (tokenizer->HasFailed() || tokenizer->IsEnd()) {
+            return SyntaxErrorAt(tokenizer);
+        } else if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {
+            tokenizer->TryNext();
+            break;
+        } else if (tokenizer->GetToken().index() == 4) {
+            if (elements.empty()) {
+                return SyntaxErrorAt(tokenizer);
+            }
+            tokenizer->TryNext();
+            auto tail = TryRead(tokenizer);
+            if (!tail) {
+                return tail;
+            }
+            if (tokenizer->HasFailed() || tokenizer->IsEnd() ||
+                tokenizer->GetToken() != Token{BracketToken::CLOSE}) {
+                return SyntaxErrorAt(tokenizer);
+            }
+            tokenizer->TryNext();
+            result = std::move(tail.value);
+            break;
         }
-        tokenizer->Next();
-        return std::make_shared<Cell>(first, second);
-    } else {
-        throw SyntaxError();
+        auto element = TryRead(tokenizer);
+        if (!element) {
+            return element;
+        }
+        elements.push_back(std::move(element.value));
+    }
+    for (auto it = elements.rbegin(); it != elements.rend(); ++it) {
+        result = Make<Cell>(*it, result);
     }
+    return result;
 }
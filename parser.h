@@ -7,4 +7,11 @@
 
 std::shared_ptr<Object> Read(Tokenizer* tokenizer);
 
-std::shared_ptr<Object> ReadList(Tokenizer* tokenizer);
\ No newline at end of file
+std::shared_ptr<Object> ReadList(Tokenizer* tokenizer);
+
+// Same as Read, but reports malformed input and nesting past the depth limit as a result
+// instead of throwing, so rejecting bad input costs no more than reading good input. The
+// offset is where the error was found.
+Result<std::shared_ptr<Object>> TryRead(Tokenizer* tokenizer);
+
+Result<std::shared_ptr<Object>> TryReadList(Tokenizer* tokenizer);
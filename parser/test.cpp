@@ -154,3 +154,29 @@ TEST_CASE("Invalid") {
     REQUIRE_THROWS_AS(ReadFull("(1 . )"), SyntaxError);
     REQUIRE_THROWS_AS(ReadFull("(1 . 2 3)"), SyntaxError);
 }
+
+Status TryReadFull(const std::string& str) {
+    std::stringstream ss{str};
+    Tokenizer tokenizer{&ss, std::nothrow};
+    return TryRead(&tokenizer);
+}
+
+TEST_CASE("Invalid without exceptions") {
+    auto status = TryReadFull("(1 2 . 3 4)");
+    REQUIRE(status.error == ErrorKind::SYNTAX);
+    REQUIRE(status.offset == 9);
+
+    REQUIRE(TryReadFull("").error == ErrorKind::SYNTAX);
+    REQUIRE(TryReadFull("(1 (2").offset == 5);
+    REQUIRE(TryReadFull("@").offset == 0);
+    REQUIRE(TryReadFull("(a b @)").offset == 5);
+    REQUIRE(TryReadFull("(1 99999999999999999999)").offset == 3);
+    REQUIRE_NOTHROW(TryReadFull("(1 . )"));
+
+    std::stringstream ss{"(1 . (2)) x"};
+    Tokenizer tokenizer{&ss, std::nothrow};
+    auto result = TryRead(&tokenizer);
+    REQUIRE(result);
+    REQUIRE(Is<Cell>(result.value));
+    REQUIRE(tokenizer.GetOffset() == 10);
+}
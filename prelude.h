@@ -0,0 +1,8 @@
+#pragma once
+
+#include <span>
+
+// Snapshot of the globals defined by prelude/prelude.scm. The prelude is evaluated when the
+// library is built and the snapshot is compiled into it as read-only data, so processes share
+// its pages and interpreters load it without reading or evaluating any code.
+std::span<const char> GetPreludeImage();
@@ -0,0 +1,6 @@
+#include "../prelude.h"
+
+// Linked into the tool that builds the prelude, which starts from no prelude at all.
+std::span<const char> GetPreludeImage() {
+    return {};
+}
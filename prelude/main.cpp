@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../scheme.h"
+
+// Evaluates the prelude and writes its snapshot as a C++ source file defining GetPreludeImage.
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "usage: scheme-prelude prelude.scm out.cpp\n";
+        return 2;
+    }
+    std::string out = argv[2];
+    std::string snapshot = out + ".snapshot";
+    try {
+        std::ifstream in(argv[1]);
+        if (!in) {
+            throw std::runtime_error(std::string(argv[1]) + ": cannot read");
+        }
+        std::stringstream program;
+        program << in.rdbuf();
+        Interpreter interpreter(0);
+        interpreter.RunAll(program.str());
+        interpreter.SaveSnapshot(snapshot);
+    } catch (const std::exception& error) {
+        std::cerr << "scheme-prelude: " << error.what() << "\n";
+        return 1;
+    }
+
+    std::ifstream in(snapshot, std::ios::binary);
+    std::string image{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    std::string source =
+        "// Generated by scheme-prelude from prelude/prelude.scm.\n\n"
+        "#include <span>\n\n"
+        "namespace {\n\n"
+        "alignas(8) const unsigned char kImage[] = {";
+    for (size_t i = 0; i < image.size(); ++i) {
+        char byte[16];
+        std::snprintf(byte, sizeof(byte), "%s%u,", i % 16 ? " " : "\n    ",
+                      static_cast<unsigned char>(image[i]));
+        source += byte;
+    }
+    source +=
+        "\n};\n\n"
+        "}  // namespace\n\n"
+        "std::span<const char> GetPreludeImage() {\n"
+        "    return {reinterpret_cast<const char*>(kImage), sizeof(kImage)};\n"
+        "}\n";
+    std::remove(snapshot.c_str());
+    std::ofstream file(out);
+    if (!(file << source)) {
+        std::cerr << "scheme-prelude: " << out << ": cannot write\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+(define (fold f acc l)
+  (if (null? l) acc (fold f (f (car l) acc) (cdr l))))
+
+(define (length l)
+  (fold (lambda (x n) (+ n 1)) 0 l))
+
+(define (reverse l)
+  (fold cons '() l))
+
+(define (fold-right f acc l)
+  (fold f acc (reverse l)))
+
+(define (append a b)
+  (fold cons b (reverse a)))
+
+(define (map f l)
+  (reverse (fold (lambda (x acc) (cons (f x) acc)) '() l)))
+
+(define (filter keep? l)
+  (reverse (fold (lambda (x acc) (if (keep? x) (cons x acc) acc)) '() l)))
+
+(define (member x l)
+  (if (null? l) #f (if (equal? x (car l)) l (member x (cdr l)))))
+
+(define (assoc key alist)
+  (if (null? alist)
+      #f
+      (if (equal? key (car (car alist))) (car alist) (assoc key (cdr alist)))))
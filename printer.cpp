@@ -0,0 +1,206 @@
+#include "printer.h"
+#include "hashtable.h"
+#include "parallel.h"
+#include "stream.h"
+
+#include <charconv>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+class Printer {
+public:
+    Printer(std::string* out, std::ostream* stream) : out_(out), stream_(stream) {
+    }
+
+    void Print(Object* root) {
+        FindShared(root);
+        std::vector<Item> stack{{Item::DATUM, root, 0}};
+        while (!stack.empty()) {
+            auto item = stack.back();
+            stack.pop_back();
+            if (item.kind == Item::DATUM) {
+                PrintDatum(item.obj, &stack);
+            } else if (item.kind == Item::TAIL) {
+                PrintTail(static_cast<Cell*>(item.obj), &stack);
+            } else if (item.kind == Item::ELEMENTS) {
+                auto& elements = static_cast<Vector*>(item.obj)->GetElements();
+                if (item.index == elements.size()) {
+                    out_->push_back(')');
+                } else {
+                    if (item.index) {
+                        out_->push_back(' ');
+                    }
+                    stack.push_back({Item::ELEMENTS, item.obj, item.index + 1});
+                    stack.push_back({Item::DATUM, elements[item.index].get(), 0});
+                }
+            } else {
+                out_->push_back(')');
+            }
+            if (stream_ && out_->size() >= kChunk) {
+                Flush();
+            }
+        }
+        if (stream_) {
+            Flush();
+        }
+    }
+
+private:
+    static constexpr size_t kChunk = 4096;
+    static constexpr int64_t kSeen = -1;
+    static constexpr int64_t kShared = -2;
+
+    struct Item {
+        // A datum, the rest of a list after its printed element, the elements of a vector from
+        // an index on, or the closing bracket of a dotted list.
+        enum Kind { DATUM, TAIL, ELEMENTS, CLOSE } kind;
+        Object* obj;
+        size_t index;
+    };
+
+    static bool IsCompound(Object* obj) {
+        return dynamic_cast<Cell*>(obj) || dynamic_cast<Vector*>(obj);
+    }
+
+    void FindShared(Object* root) {
+        std::vector<Object*> stack{root};
+        while (!stack.empty()) {
+            auto obj = stack.back();
+            stack.pop_back();
+            if (!IsCompound(obj)) {
+                continue;
+            }
+            auto [it, inserted] = labels_.try_emplace(obj, kSeen);
+            if (!inserted) {
+                it->second = kShared;
+            } else if (auto cell = dynamic_cast<Cell*>(obj)) {
+                stack.push_back(cell->GetSecond().get());
+                stack.push_back(cell->GetFirst().get());
+            } else {
+                for (const auto& element : static_cast<Vector*>(obj)->GetElements()) {
+                    stack.push_back(element.get());
+                }
+            }
+        }
+    }
+
+    bool IsShared(Object* obj) const {
+        auto it = labels_.find(obj);
+        return it != labels_.end() && it->second != kSeen;
+    }
+
+    // Writes the label of a shared datum. Returns false if the datum has been written already,
+    // so only a reference to it was.
+    bool PrintLabel(Object* obj) {
+        auto& label = labels_.at(obj);
+        if (label == kSeen) {
+            return true;
+        }
+        out_->push_back('#');
+        if (label >= 0) {
+            PrintNumber(label);
+            out_->push_back('#');
+            return false;
+        }
+        label = next_label_++;
+        PrintNumber(label);
+        out_->push_back('=');
+        return true;
+    }
+
+    void PrintDatum(Object* obj, std::vector<Item>* stack) {
+        if (!obj) {
+            out_->append("()");
+        } else if (auto number = dynamic_cast<Number*>(obj)) {
+            PrintNumber(number->GetValue());
+        } else if (auto symbol = dynamic_cast<Symbol*>(obj)) {
+            out_->append(symbol->GetName());
+        } else if (auto boolean = dynamic_cast<Boolean*>(obj)) {
+            out_->append(boolean->GetValue() ? "#t" : "#f");
+        } else if (auto cell = dynamic_cast<Cell*>(obj)) {
+            if (PrintLabel(obj)) {
+                out_->push_back('(');
+                stack->push_back({Item::TAIL, obj, 0});
+                stack->push_back({Item::DATUM, cell->GetFirst().get(), 0});
+            }
+        } else if (dynamic_cast<Vector*>(obj)) {
+            if (PrintLabel(obj)) {
+                out_->append("#(");
+                stack->push_back({Item::ELEMENTS, obj, 0});
+            }
+        } else if (auto string = dynamic_cast<String*>(obj)) {
+            PrintString(string->GetView());
+        } else if (dynamic_cast<HashTable*>(obj)) {
+            out_->append("#<hash-table>");
+        } else if (dynamic_cast<Promise*>(obj)) {
+            out_->append("#<promise>");
+        } else if (dynamic_cast<Future*>(obj)) {
+            out_->append("#<future>");
+        } else {
+            out_->append("#<procedure>");
+        }
+    }
+
+    void PrintTail(Cell* cell, std::vector<Item>* stack) {
+        auto rest = cell->GetSecond().get();
+        if (!rest) {
+            out_->push_back(')');
+        } else if (dynamic_cast<Cell*>(rest) && !IsShared(rest)) {
+            out_->push_back(' ');
+            stack->push_back({Item::TAIL, rest, 0});
+            stack->push_back({Item::DATUM, static_cast<Cell*>(rest)->GetFirst().get(), 0});
+        } else {
+            out_->append(" . ");
+            stack->push_back({Item::CLOSE, nullptr, 0});
+            stack->push_back({Item::DATUM, rest, 0});
+        }
+    }
+
+    void PrintNumber(int64_t value) {
+        char digits[24];
+        auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        out_->append(digits, end);
+    }
+
+    void PrintString(std::string_view text) {
+        out_->push_back('"');
+        for (auto c : text) {
+            if (c == '"' || c == '\\') {
+                out_->push_back('\\');
+                out_->push_back(c);
+            } else if (c == '\n') {
+                out_->append("\\n");
+            } else if (c == '\t') {
+                out_->append("\\t");
+            } else {
+                out_->push_back(c);
+            }
+        }
+        out_->push_back('"');
+    }
+
+    void Flush() {
+        stream_->write(out_->data(), out_->size());
+        out_->clear();
+    }
+
+    std::string* out_;
+    std::ostream* stream_;
+    // Pairs and vectors by identity: kSeen if reached once, kShared if reached again and not
+    // labeled yet, the label otherwise.
+    std::unordered_map<Object*, int64_t> labels_;
+    int64_t next_label_ = 0;
+};
+
+}  // namespace
+
+void Print(const std::shared_ptr<Object>& obj, std::string* out) {
+    Printer(out, nullptr).Print(obj.get());
+}
+
+void Print(const std::shared_ptr<Object>& obj, std::ostream* out) {
+    std::string buffer;
+    Printer(&buffer, out).Print(obj.get());
+}
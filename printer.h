@@ -0,0 +1,17 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "object.h"
+
+// Writes the external representation of a datum, the way the reader reads it back. Promises,
+// futures and procedures are written as #<promise>, #<future> and #<procedure>. Pairs and
+// vectors reachable more than once, including those on a cycle, are written once with a datum
+// label, #0=, and referred to as #0# afterwards. Printing takes time linear in the size of the
+// datum and constant native stack.
+void Print(const std::shared_ptr<Object>& obj, std::string* out);
+
+// Same as above, written to the stream in chunks as the output grows.
+void Print(const std::shared_ptr<Object>& obj, std::ostream* out);
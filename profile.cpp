@@ -0,0 +1,118 @@
+#include "profile.h"
+#include "memoize.h"
+
+#include <algorithm>
+#include <vector>
+
+thread_local constinit const char* allocation_site = nullptr;
+
+void ProfileAllocation(AllocationProfile* profile, const char* type, size_t bytes) {
+    profile->Allocate(type, bytes);
+}
+
+void ProfileFree(AllocationProfile* profile, const char* type, size_t bytes) {
+    profile->Free(type, bytes);
+}
+
+void AllocationProfile::Allocate(const char* type, size_t bytes) {
+    std::lock_guard lock(mutex_);
+    auto& by_type = types_[type];
+    ++by_type.allocations;
+    by_type.bytes += bytes;
+    auto& by_site = sites_[allocation_site ? allocation_site : "other"];
+    ++by_site.allocations;
+    by_site.bytes += bytes;
+}
+
+void AllocationProfile::Free(const char* type, size_t bytes) {
+    std::lock_guard lock(mutex_);
+    auto& by_type = types_[type];
+    ++by_type.frees;
+    by_type.freed_bytes += bytes;
+}
+
+void AllocationProfile::AddRun(size_t peak_bytes) {
+    std::lock_guard lock(mutex_);
+    ++runs_;
+    max_peak_ = std::max(max_peak_, peak_bytes);
+}
+
+namespace {
+
+std::map<std::string, AllocationCounts> ToMap(
+    const std::unordered_map<const char*, AllocationCounts>& counts) {
+    std::map<std::string, AllocationCounts> result;
+    for (const auto& [name, count] : counts) {
+        auto& merged = result[name];
+        merged.allocations += count.allocations;
+        merged.bytes += count.bytes;
+        merged.frees += count.frees;
+        merged.freed_bytes += count.freed_bytes;
+    }
+    return result;
+}
+
+void AppendTable(const std::map<std::string, AllocationCounts>& counts, bool live,
+                 std::string* out) {
+    std::vector<std::pair<std::string, AllocationCounts>> rows(counts.begin(), counts.end());
+    std::sort(rows.begin(), rows.end(),
+              [](const auto& a, const auto& b) { return a.second.bytes > b.second.bytes; });
+    for (const auto& [name, count] : rows) {
+        *out += "  " + name + std::string(name.size() < 24 ? 24 - name.size() : 1, ' ') +
+                std::to_string(count.allocations) + " allocations, " +
+                std::to_string(count.bytes) + " bytes";
+        if (live) {
+            *out += ", " + std::to_string(count.bytes - count.freed_bytes) + " live";
+        }
+        *out += "\n";
+    }
+}
+
+}  // namespace
+
+std::map<std::string, AllocationCounts> AllocationProfile::GetTypes() const {
+    std::lock_guard lock(mutex_);
+    return ToMap(types_);
+}
+
+std::map<std::string, AllocationCounts> AllocationProfile::GetSites() const {
+    std::lock_guard lock(mutex_);
+    return ToMap(sites_);
+}
+
+uint64_t AllocationProfile::GetRuns() const {
+    std::lock_guard lock(mutex_);
+    return runs_;
+}
+
+size_t AllocationProfile::GetMaxPeak() const {
+    std::lock_guard lock(mutex_);
+    return max_peak_;
+}
+
+std::string AllocationProfile::Report() const {
+    std::string out = "runs: " + std::to_string(GetRuns()) +
+                      ", max peak heap: " + std::to_string(GetMaxPeak()) + " bytes\nby type:\n";
+    AppendTable(GetTypes(), true, &out);
+    out += "by site:\n";
+    AppendTable(GetSites(), false, &out);
+    return out;
+}
+
+const char* SiteName(const Function* function) {
+    static const auto names = [] {
+        std::unordered_map<const Function*, const char*> result;
+        for (const auto& [name, builtin] : GetBuiltins()) {
+            result[builtin.get()] = name.c_str();
+        }
+        return result;
+    }();
+    if (auto it = names.find(function); it != names.end()) {
+        return it->second;
+    } else if (dynamic_cast<const Closure*>(function)) {
+        return "closure";
+    } else if (dynamic_cast<const Memoized*>(function)) {
+        return "memoized";
+    }
+    return "function";
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "object.h"
+
+struct AllocationCounts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t frees = 0;
+    uint64_t freed_bytes = 0;
+};
+
+// Allocations of an interpreter by type and by site. The site is the builtin being applied, a
+// closure or memoized call, or the phase of the run outside evaluation: read, optimize or
+// print. Frees are only known by type. The profile also keeps the peak heap of the runs.
+class AllocationProfile {
+public:
+    void Allocate(const char* type, size_t bytes);
+
+    void Free(const char* type, size_t bytes);
+
+    void AddRun(size_t peak_bytes);
+
+    std::map<std::string, AllocationCounts> GetTypes() const;
+
+    std::map<std::string, AllocationCounts> GetSites() const;
+
+    uint64_t GetRuns() const;
+
+    // The largest peak heap of a run since profiling started.
+    size_t GetMaxPeak() const;
+
+    // Types and sites ordered by the bytes they allocated.
+    std::string Report() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<const char*, AllocationCounts> types_;
+    std::unordered_map<const char*, AllocationCounts> sites_;
+    uint64_t runs_ = 0;
+    size_t max_peak_ = 0;
+};
+
+// Site of the allocations made on this thread. Only set while profiling, so it also tells
+// the evaluator whether to track sites at all.
+extern thread_local constinit const char* allocation_site;
+
+class AllocationSiteGuard {
+public:
+    AllocationSiteGuard(const char* site) : saved_(allocation_site) {
+        allocation_site = site;
+    }
+
+    ~AllocationSiteGuard() {
+        allocation_site = saved_;
+    }
+
+private:
+    const char* saved_;
+};
+
+// Name of the site of a function: the name of a builtin, or its kind otherwise.
+const char* SiteName(const Function* function);
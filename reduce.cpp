@@ -0,0 +1,204 @@
+#include "reduce.h"
+
+#include <algorithm>
+#include <functional>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SCHEME_REDUCE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+
+std::optional<int64_t> Narrow(__int128 value) {
+    if (value < INT64_MIN || value > INT64_MAX) {
+        return std::nullopt;
+    }
+    return static_cast<int64_t>(value);
+}
+
+std::optional<int64_t> SumScalar(const int64_t* data, size_t size) {
+    __int128 result = 0;
+    for (size_t i = 0; i < size; ++i) {
+        result += data[i];
+    }
+    return Narrow(result);
+}
+
+template <class Less>
+int64_t ExtremumScalar(const int64_t* data, size_t size, Less less) {
+    int64_t result = data[0];
+    for (size_t i = 1; i < size; ++i) {
+        if (less(data[i], result)) {
+            result = data[i];
+        }
+    }
+    return result;
+}
+
+bool InOrder(int64_t x, int64_t y, Order order) {
+    switch (order) {
+        case Order::EQUAL:
+            return x == y;
+        case Order::LESS:
+            return x < y;
+        case Order::GREATER:
+            return x > y;
+        case Order::LESS_EQUAL:
+            return x <= y;
+        default:
+            return x >= y;
+    }
+}
+
+bool IsOrderedScalar(const int64_t* data, size_t size, Order order) {
+    for (size_t i = 1; i < size; ++i) {
+        if (!InOrder(data[i - 1], data[i], order)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef SCHEME_REDUCE_AVX2
+
+bool HasAvx2() {
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+
+__attribute__((target("avx2"))) __m256i Load(const int64_t* data) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+// Lanes wrap around; a lane that overflowed at any point sends the whole sum to the exact
+// scalar path, since the true total may still fit.
+__attribute__((target("avx2"))) std::optional<int64_t> SumAvx2(const int64_t* data,
+                                                                size_t size) {
+    __m256i sum = _mm256_setzero_si256();
+    __m256i overflow = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m256i x = Load(data + i);
+        __m256i next = _mm256_add_epi64(sum, x);
+        overflow = _mm256_or_si256(
+            overflow, _mm256_and_si256(_mm256_xor_si256(sum, next), _mm256_xor_si256(x, next)));
+        sum = next;
+    }
+    if (_mm256_movemask_pd(_mm256_castsi256_pd(overflow))) {
+        return SumScalar(data, size);
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sum);
+    __int128 result = 0;
+    for (auto lane : lanes) {
+        result += lane;
+    }
+    for (; i < size; ++i) {
+        result += data[i];
+    }
+    return Narrow(result);
+}
+
+template <bool kMin>
+__attribute__((target("avx2"))) int64_t ExtremumAvx2(const int64_t* data, size_t size) {
+    __m256i result = _mm256_set1_epi64x(data[0]);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m256i x = Load(data + i);
+        __m256i take = kMin ? _mm256_cmpgt_epi64(result, x) : _mm256_cmpgt_epi64(x, result);
+        result = _mm256_blendv_epi8(result, x, take);
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), result);
+    int64_t extremum = kMin ? std::min({lanes[0], lanes[1], lanes[2], lanes[3]})
+                            : std::max({lanes[0], lanes[1], lanes[2], lanes[3]});
+    for (; i < size; ++i) {
+        extremum = kMin ? std::min(extremum, data[i]) : std::max(extremum, data[i]);
+    }
+    return extremum;
+}
+
+// Lanes of the result are all ones where the pair (x, y) breaks the order.
+__attribute__((target("avx2"))) __m256i Violations(__m256i x, __m256i y, Order order) {
+    __m256i ones = _mm256_set1_epi64x(-1);
+    switch (order) {
+        case Order::EQUAL:
+            return _mm256_xor_si256(_mm256_cmpeq_epi64(x, y), ones);
+        case Order::LESS:
+            return _mm256_xor_si256(_mm256_cmpgt_epi64(y, x), ones);
+        case Order::GREATER:
+            return _mm256_xor_si256(_mm256_cmpgt_epi64(x, y), ones);
+        case Order::LESS_EQUAL:
+            return _mm256_cmpgt_epi64(x, y);
+        default:
+            return _mm256_cmpgt_epi64(y, x);
+    }
+}
+
+__attribute__((target("avx2"))) bool IsOrderedAvx2(const int64_t* data, size_t size,
+                                                   Order order) {
+    size_t i = 0;
+    for (; i + 5 <= size; i += 4) {
+        __m256i bad = Violations(Load(data + i), Load(data + i + 1), order);
+        if (!_mm256_testz_si256(bad, bad)) {
+            return false;
+        }
+    }
+    return IsOrderedScalar(data + i, size - i, order);
+}
+
+#endif
+
+}  // namespace
+
+std::optional<int64_t> SumNumbers(const int64_t* data, size_t size) {
+#ifdef SCHEME_REDUCE_AVX2
+    if (HasAvx2()) {
+        return SumAvx2(data, size);
+    }
+#endif
+    return SumScalar(data, size);
+}
+
+// There is no 64-bit lane multiply below AVX-512, so products stay scalar.
+std::optional<int64_t> MulNumbers(const int64_t* data, size_t size) {
+    if (std::find(data, data + size, 0) != data + size) {
+        return 0;
+    }
+    int64_t result = 1;
+    for (size_t i = 0; i < size; ++i) {
+        // Every factor is at least 1 in absolute value, so an overflow is never undone later.
+        if (__builtin_mul_overflow(result, data[i], &result)) {
+            return std::nullopt;
+        }
+    }
+    return result;
+}
+
+int64_t MinNumber(const int64_t* data, size_t size) {
+#ifdef SCHEME_REDUCE_AVX2
+    if (HasAvx2()) {
+        return ExtremumAvx2<true>(data, size);
+    }
+#endif
+    return ExtremumScalar(data, size, std::less<int64_t>());
+}
+
+int64_t MaxNumber(const int64_t* data, size_t size) {
+#ifdef SCHEME_REDUCE_AVX2
+    if (HasAvx2()) {
+        return ExtremumAvx2<false>(data, size);
+    }
+#endif
+    return ExtremumScalar(data, size, std::greater<int64_t>());
+}
+
+bool IsOrdered(const int64_t* data, size_t size, Order order) {
+#ifdef SCHEME_REDUCE_AVX2
+    if (HasAvx2()) {
+        return IsOrderedAvx2(data, size, order);
+    }
+#endif
+    return IsOrderedScalar(data, size, order);
+}
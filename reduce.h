@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// Reductions over contiguous fixnums, vectorized with AVX2 when the CPU supports it.
+
+// Exact sum, or std::nullopt when it does not fit into int64_t.
+std::optional<int64_t> SumNumbers(const int64_t* data, size_t size);
+
+// Exact product, or std::nullopt when it does not fit into int64_t.
+std::optional<int64_t> MulNumbers(const int64_t* data, size_t size);
+
+// Both expect size > 0.
+int64_t MinNumber(const int64_t* data, size_t size);
+int64_t MaxNumber(const int64_t* data, size_t size);
+
+enum class Order { EQUAL, LESS, GREATER, LESS_EQUAL, GREATER_EQUAL };
+
+// Whether every pair of adjacent numbers is in the given order.
+bool IsOrdered(const int64_t* data, size_t size, Order order);
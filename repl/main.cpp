@@ -1,5 +1,71 @@
-#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
 
-int main() {
-    return 0;
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "session.h"
+
+namespace {
+
+void PrintUsage() {
+    Writer err(STDERR_FILENO);
+    err.Write("usage: scheme-repl [--pipe] [--time] [--profile] [--sample out] [file...]\n"
+              "  --pipe     never prompt, even when reading from a terminal\n"
+              "  --time     print the time of every expression and the totals to stderr\n"
+              "  --profile  print the allocations by type and by builtin to stderr at the end\n"
+              "  --sample   sample the call stacks every 1000 steps and write them to out as\n"
+              "             folded stacks for flamegraph tools\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    ReplOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--pipe" || arg == "-p") {
+            options.pipe = true;
+        } else if (arg == "--time" || arg == "-t") {
+            options.timing = true;
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg == "--sample" && i + 1 < argc) {
+            options.sample = argv[++i];
+        } else if (arg.starts_with("-") && arg != "-") {
+            PrintUsage();
+            return 2;
+        } else {
+            options.files.emplace_back(arg);
+        }
+    }
+    Session session(options);
+    if (options.files.empty()) {
+        options.files.emplace_back("-");
+    }
+    for (const auto& file : options.files) {
+        int fd = file == "-" ? STDIN_FILENO : open(file.c_str(), O_RDONLY);
+        if (fd < 0 || !session.Process(fd)) {
+            Writer err(STDERR_FILENO);
+            err.Write("scheme-repl: " + file + ": " + std::strerror(errno) + "\n");
+            return 2;
+        }
+        if (fd != STDIN_FILENO) {
+            close(fd);
+        }
+    }
+    if (options.timing) {
+        session.PrintTotals();
+    }
+    if (options.profile) {
+        session.PrintProfile();
+    }
+    if (!options.sample.empty() && !session.WriteSamples(options.sample)) {
+        Writer err(STDERR_FILENO);
+        err.Write("scheme-repl: " + options.sample + ": " + std::strerror(errno) + "\n");
+        return 2;
+    }
+    return session.GetErrors() ? 1 : 0;
 }
@@ -0,0 +1,153 @@
+#include "session.h"
+
+#include <cerrno>
+#include <sstream>
+#include <variant>
+
+#include <fcntl.h>
+
+namespace {
+
+constexpr size_t kReadSize = 1 << 20;
+
+}  // namespace
+
+void Writer::Flush() {
+    size_t written = 0;
+    while (written < buffer_.size()) {
+        auto result = write(fd_, buffer_.data() + written, buffer_.size() - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        } else if (result < 0) {
+            break;
+        }
+        written += result;
+    }
+    buffer_.clear();
+}
+
+Session::Session(const ReplOptions& options, int out, int err)
+    : interactive_(!options.pipe && isatty(STDIN_FILENO) && options.files.empty()),
+      timing_(options.timing),
+      out_(out),
+      err_(err) {
+    if (options.profile) {
+        interpreter_.EnableProfiling();
+    }
+    if (!options.sample.empty()) {
+        interpreter_.EnableSampling();
+    }
+}
+
+bool Session::Process(int fd) {
+    std::string block(kReadSize, '\0');
+    while (true) {
+        if (interactive_ && pending_.empty()) {
+            out_.Write("> ");
+            out_.Flush();
+        }
+        auto size = read(fd, block.data(), block.size());
+        if (size < 0 && errno == EINTR) {
+            continue;
+        } else if (size < 0) {
+            return false;
+        } else if (size == 0) {
+            break;
+        }
+        std::string_view rest(block.data(), size);
+        while (!rest.empty()) {
+            auto end = rest.find('\n');
+            auto line = rest.substr(0, end == rest.npos ? rest.size() : end + 1);
+            rest.remove_prefix(line.size());
+            pending_.append(line);
+            if (line.back() == '\n' && IsComplete()) {
+                Evaluate();
+            }
+        }
+        if (interactive_) {
+            out_.Flush();
+        }
+    }
+    Evaluate();
+    return true;
+}
+
+// The brackets are counted on the tokens of the reader, so that brackets in strings do not
+// count. A character no token starts with is skipped; the error is reported when the form is
+// evaluated.
+bool Session::IsComplete() {
+    while (scanned_ < pending_.size()) {
+        std::istringstream in(pending_.substr(scanned_));
+        Tokenizer tokenizer(&in, std::nothrow);
+        while (!tokenizer.HasFailed() && !tokenizer.IsEnd()) {
+            auto token = tokenizer.GetToken();
+            if (auto bracket = std::get_if<BracketToken>(&token)) {
+                depth_ += *bracket == BracketToken::OPEN ? 1 : -1;
+            }
+            tokenizer.TryNext();
+        }
+        if (!tokenizer.HasFailed()) {
+            scanned_ = pending_.size();
+        } else if (pending_[scanned_ + tokenizer.GetOffset()] == '"') {
+            scanned_ += tokenizer.GetOffset();
+            return false;
+        } else {
+            scanned_ += tokenizer.GetOffset() + 1;
+        }
+    }
+    return depth_ <= 0;
+}
+
+void Session::PrintTotals() {
+    auto seconds = std::chrono::duration<double>(total_).count();
+    err_.Write("; " + std::to_string(expressions_) + " expressions, " + std::to_string(errors_) +
+               " errors in " + std::to_string(seconds) + " s");
+    if (seconds > 0) {
+        err_.Write(", " + std::to_string(static_cast<int64_t>(expressions_ / seconds)) +
+                   " expressions/s");
+    }
+    err_.Write("\n");
+}
+
+void Session::PrintProfile() {
+    err_.Write(interpreter_.GetProfile()->Report());
+}
+
+bool Session::WriteSamples(const std::string& file) {
+    int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    Writer(fd).Write(interpreter_.GetSampler()->GetFolded());
+    return close(fd) == 0;
+}
+
+void Session::Evaluate() {
+    depth_ = 0;
+    scanned_ = 0;
+    if (pending_.find_first_not_of(" \t\r\n") == pending_.npos) {
+        pending_.clear();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    try {
+        for (const auto& result : interpreter_.RunAll(pending_)) {
+            out_.Write(result);
+            out_.Write("\n");
+            ++expressions_;
+        }
+    } catch (const std::exception& error) {
+        out_.Write("error: ");
+        out_.Write(error.what());
+        out_.Write("\n");
+        ++expressions_;
+        ++errors_;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    total_ += elapsed;
+    if (timing_) {
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        err_.Write("; " + std::to_string(micros) + " us\n");
+    }
+    pending_.clear();
+}
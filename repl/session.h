@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../scheme.h"
+
+// Collects output and hands it to the kernel in large writes.
+class Writer {
+public:
+    static constexpr size_t kWriteSize = 1 << 16;
+
+    explicit Writer(int fd) : fd_(fd) {
+        buffer_.reserve(kWriteSize);
+    }
+
+    ~Writer() {
+        Flush();
+    }
+
+    void Write(std::string_view text) {
+        buffer_.append(text);
+        if (buffer_.size() >= kWriteSize) {
+            Flush();
+        }
+    }
+
+    void Flush();
+
+private:
+    int fd_;
+    std::string buffer_;
+};
+
+struct ReplOptions {
+    bool pipe = false;
+    bool timing = false;
+    bool profile = false;
+    std::string sample;
+    std::vector<std::string> files;
+};
+
+// Evaluates the input of scheme-repl and writes the results to `out` and diagnostics to `err`.
+class Session {
+public:
+    explicit Session(const ReplOptions& options, int out = STDOUT_FILENO,
+                     int err = STDERR_FILENO);
+
+    // Reads the input in large blocks and evaluates it one line at a time. A line that leaves
+    // brackets or a string open is continued by the following lines.
+    bool Process(int fd);
+
+    void PrintTotals();
+
+    void PrintProfile();
+
+    // Writes the sampled stacks in the folded format that flamegraph.pl and speedscope read.
+    bool WriteSamples(const std::string& file);
+
+    size_t GetErrors() const {
+        return errors_;
+    }
+
+private:
+    // Whether the input collected so far ends outside of any form. Tokenizes only what was added
+    // since the last call, except for a string still open, which is read again.
+    bool IsComplete();
+
+    void Evaluate();
+
+    bool interactive_;
+    bool timing_;
+    Writer out_;
+    Writer err_;
+    Interpreter interpreter_;
+    std::string pending_;
+    // Brackets left open in pending_ up to scanned_.
+    int64_t depth_ = 0;
+    size_t scanned_ = 0;
+    size_t expressions_ = 0;
+    size_t errors_ = 0;
+    std::chrono::steady_clock::duration total_{};
+};
@@ -0,0 +1,94 @@
+#include "sampler.h"
+#include "budget.h"
+#include "profile.h"
+
+#include <algorithm>
+
+thread_local constinit std::vector<const Function*>* call_stack = nullptr;
+
+namespace {
+
+thread_local constinit Sampler* current_sampler = nullptr;
+
+void AppendFrame(const Function* function, std::string* stack) {
+    if (!stack->empty()) {
+        *stack += ';';
+    }
+    if (auto closure = dynamic_cast<const Closure*>(function)) {
+        *stack += closure->GetName().empty() ? "lambda" : closure->GetName();
+    } else {
+        *stack += SiteName(function);
+    }
+}
+
+}  // namespace
+
+void TakeSample() {
+    if (current_sampler && call_stack) {
+        current_sampler->Sample(*call_stack);
+    }
+}
+
+void Sampler::Sample(const std::vector<const Function*>& frames) {
+    std::string stack;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (i + 1 == frames.size() || dynamic_cast<const Closure*>(frames[i])) {
+            AppendFrame(frames[i], &stack);
+        }
+    }
+    if (stack.empty()) {
+        stack = "(toplevel)";
+    }
+    std::lock_guard lock(mutex_);
+    ++stacks_[stack];
+    ++samples_;
+}
+
+uint64_t Sampler::GetSamples() const {
+    std::lock_guard lock(mutex_);
+    return samples_;
+}
+
+std::string Sampler::GetFolded() const {
+    std::vector<std::pair<std::string, uint64_t>> stacks;
+    {
+        std::lock_guard lock(mutex_);
+        stacks.assign(stacks_.begin(), stacks_.end());
+    }
+    std::sort(stacks.begin(), stacks.end());
+    std::string result;
+    for (const auto& [stack, count] : stacks) {
+        result += stack + " " + std::to_string(count) + "\n";
+    }
+    return result;
+}
+
+Sampler* CurrentSampler() {
+    return current_sampler;
+}
+
+SamplingGuard::SamplingGuard(Sampler* sampler, std::vector<const Function*> frames)
+    : saved_sampler_(current_sampler),
+      saved_stack_(call_stack),
+      saved_interval_(budget.sample_interval),
+      saved_left_(budget.sample_left),
+      stack_(std::move(frames)) {
+    current_sampler = sampler;
+    call_stack = sampler ? &stack_ : nullptr;
+    if (sampler) {
+        SettleBudget();
+        budget.sample_interval = budget.sample_left = sampler->GetInterval();
+        RefillBudget();
+    }
+}
+
+SamplingGuard::~SamplingGuard() {
+    if (current_sampler) {
+        SettleBudget();
+        budget.sample_interval = saved_interval_;
+        budget.sample_left = saved_left_;
+        RefillBudget();
+    }
+    current_sampler = saved_sampler_;
+    call_stack = saved_stack_;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "object.h"
+
+// Procedures being applied on this thread, innermost last. Only kept while sampling.
+extern thread_local constinit std::vector<const Function*>* call_stack;
+
+class CallFrame {
+public:
+    CallFrame(const Function* function) : stack_(function ? call_stack : nullptr) {
+        if (stack_) {
+            stack_->push_back(function);
+        }
+    }
+
+    ~CallFrame() {
+        if (stack_) {
+            stack_->pop_back();
+        }
+    }
+
+private:
+    std::vector<const Function*>* stack_;
+};
+
+// Call stacks of an interpreter's runs, sampled every `interval` evaluation steps and counted
+// in the folded format of flamegraph tools: the frames from the outermost in, separated by
+// semicolons, then the number of samples. Closures are named after the variable they were
+// defined as. Builtins only appear as the innermost frame, since everything else they do is
+// evaluating their arguments.
+class Sampler {
+public:
+    explicit Sampler(int64_t interval) : interval_(interval) {
+    }
+
+    int64_t GetInterval() const {
+        return interval_;
+    }
+
+    void Sample(const std::vector<const Function*>& frames);
+
+    uint64_t GetSamples() const;
+
+    // One line per distinct stack, ordered by stack.
+    std::string GetFolded() const;
+
+private:
+    int64_t interval_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, uint64_t> stacks_;
+    uint64_t samples_ = 0;
+};
+
+// Sampler of the program running on this thread, null when it is not sampled.
+Sampler* CurrentSampler();
+
+// Samples the program running on this thread with `sampler` until destroyed, below `frames` if
+// given: a task of the pool starts from the stack it was submitted from. A null sampler stops
+// sampling, which is what the scheduler does for a task that yields.
+class SamplingGuard {
+public:
+    SamplingGuard(Sampler* sampler, std::vector<const Function*> frames = {});
+
+    ~SamplingGuard();
+
+private:
+    Sampler* saved_sampler_;
+    std::vector<const Function*>* saved_stack_;
+    int64_t saved_interval_;
+    int64_t saved_left_;
+    std::vector<const Function*> stack_;
+};
@@ -0,0 +1,155 @@
+#include "scheduler.h"
+#include "budget.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+struct Scheduler::Task {
+    Task(Interpreter* interpreter, std::string program)
+        : interpreter(interpreter), program(std::move(program)) {
+    }
+
+    ~Task() {
+        if (stack) {
+            munmap(stack, stack_size);
+        }
+    }
+
+    Interpreter* interpreter;
+    std::string program;
+    std::promise<std::string> result;
+    Budget budget;
+    ucontext_t context;
+    ucontext_t* caller = nullptr;
+    void* stack = nullptr;
+    size_t stack_size = 0;
+    bool finished = false;
+};
+
+namespace {
+
+thread_local Scheduler::Task* current_task = nullptr;
+
+void RunTask() {
+    auto task = current_task;
+    try {
+        task->result.set_value(task->interpreter->Run(task->program));
+    } catch (...) {
+        task->result.set_exception(std::current_exception());
+    }
+    task->finished = true;
+}
+
+}  // namespace
+
+void YieldTask() {
+    auto task = current_task;
+    if (!task) {
+        return;
+    }
+    // The evaluator keeps its state in thread-locals, which belong to whichever task runs next.
+    ScopeGuard scope_guard(nullptr);
+    EnvironmentGuard environment_guard(nullptr);
+    PoolGuard pool_guard(nullptr);
+    HeapGuard heap_guard(nullptr);
+    AllocationSiteGuard site_guard(nullptr);
+    SamplingGuard sampling_guard(nullptr);
+    StatsGuard stats_guard(nullptr);
+    swapcontext(&task->context, task->caller);
+}
+
+Scheduler::Scheduler(size_t threads, int64_t quantum, size_t stack_size)
+    : quantum_(quantum), stack_size_(stack_size) {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (auto& worker : workers_) {
+        worker->thread = std::thread([this, worker = worker.get()] { WorkerLoop(worker); });
+    }
+}
+
+Scheduler::~Scheduler() {
+    for (auto& worker : workers_) {
+        {
+            std::lock_guard lock(worker->mutex);
+            worker->stop = true;
+        }
+        worker->wake.notify_one();
+    }
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+std::future<std::string> Scheduler::Submit(Interpreter* interpreter, std::string program) {
+    auto task = std::make_unique<Task>(interpreter, std::move(program));
+    auto result = task->result.get_future();
+    auto& worker = *workers_[std::hash<Interpreter*>()(interpreter) % workers_.size()];
+    {
+        std::lock_guard lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    worker.wake.notify_one();
+    return result;
+}
+
+void Scheduler::WorkerLoop(Worker* worker) {
+    ucontext_t loop_context;
+    // Interpreters with a started, unfinished task.
+    std::unordered_set<Interpreter*> busy;
+    while (true) {
+        std::unique_ptr<Task> task;
+        {
+            std::unique_lock lock(worker->mutex);
+            worker->wake.wait(lock, [worker] { return worker->stop || !worker->tasks.empty(); });
+            if (worker->tasks.empty()) {
+                return;
+            }
+            for (auto it = worker->tasks.begin(); it != worker->tasks.end(); ++it) {
+                if ((*it)->stack || !busy.contains((*it)->interpreter)) {
+                    task = std::move(*it);
+                    worker->tasks.erase(it);
+                    break;
+                }
+            }
+        }
+        if (!task->stack) {
+            // The lowest page stays inaccessible, so an overflow faults instead of corrupting.
+            size_t page = sysconf(_SC_PAGESIZE);
+            task->stack_size = (stack_size_ + page - 1) / page * page + page;
+            task->stack = mmap(nullptr, task->stack_size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (task->stack == MAP_FAILED) {
+                task->stack = nullptr;
+                task->result.set_exception(std::make_exception_ptr(std::bad_alloc()));
+                continue;
+            }
+            mprotect(task->stack, page, PROT_NONE);
+            getcontext(&task->context);
+            task->context.uc_stack.ss_sp = static_cast<char*>(task->stack) + page;
+            task->context.uc_stack.ss_size = task->stack_size - page;
+            task->context.uc_link = &loop_context;
+            makecontext(&task->context, RunTask, 0);
+            task->budget.quantum = task->budget.quantum_left = quantum_;
+            task->budget.steps_left = task->budget.window = quantum_;
+            busy.insert(task->interpreter);
+        }
+        current_task = task.get();
+        task->caller = &loop_context;
+        budget = task->budget;
+        swapcontext(&loop_context, &task->context);
+        current_task = nullptr;
+        task->budget = budget;
+        budget = Budget();
+        if (task->finished) {
+            busy.erase(task->interpreter);
+        } else {
+            std::lock_guard lock(worker->mutex);
+            worker->tasks.push_back(std::move(task));
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "scheme.h"
+
+// Runs programs as cooperative tasks on a few threads. Every task has its own stack and yields
+// back to its thread once it has used up a quantum of evaluation steps, so a runaway program
+// delays the others by at most one quantum at a time. Programs of one interpreter run on the
+// same thread, one after another in the order they were submitted. Stacks are reserved
+// lazily, so only the pages a program touches are committed.
+class Scheduler {
+public:
+    static constexpr int64_t kDefaultQuantum = 10000;
+    static constexpr size_t kDefaultStackSize = 8 << 20;
+
+    explicit Scheduler(size_t threads = 1, int64_t quantum = kDefaultQuantum,
+                       size_t stack_size = kDefaultStackSize);
+
+    // Waits for every submitted program to finish.
+    ~Scheduler();
+
+    // The interpreter has to outlive the program and must not be run outside the scheduler
+    // until the returned future is ready.
+    std::future<std::string> Submit(Interpreter* interpreter, std::string program);
+
+    struct Task;
+
+private:
+
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<std::unique_ptr<Task>> tasks;
+        bool stop = false;
+        std::thread thread;
+    };
+
+    void WorkerLoop(Worker* worker);
+
+    int64_t quantum_;
+    size_t stack_size_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
@@ -1,59 +1,221 @@
 #include "scheme.h"
+#include "hashtable.h"
+#include "prelude.h"
+#include "printer.h"
+#include "snapshot.h"
+#include "stream.h"
 
-std::string PrintCell(std::shared_ptr<Object> obj) {
-    std::string result;
-    if (!obj) {
-        return result;
-    }
-    if (!As<Cell>(obj)->GetFirst()) {
-        result += "()";
-    } else if (Is<Number>(As<Cell>(obj)->GetFirst())) {
-        result += std::to_string(As<Number>(As<Cell>(obj)->GetFirst())->GetValue());
-    } else if (Is<Symbol>(As<Cell>(obj)->GetFirst())) {
-        result += As<Symbol>(As<Cell>(obj)->GetFirst())->GetName();
-    } else if (Is<Boolean>(As<Cell>(obj)->GetFirst())) {
-        result += As<Boolean>(As<Cell>(obj)->GetFirst())->GetValue() ? "#t" : "#f";
-    } else if (Is<Cell>(As<Cell>(obj)->GetFirst())) {
-        result += PrintCell(As<Cell>(obj)->GetFirst());
-    }
-    if (!As<Cell>(obj)->GetSecond()) {
-        return result;
-    } else if (Is<Number>(As<Cell>(obj)->GetSecond())) {
-        result += (As<Cell>(obj)->GetFirst() ? " . " : "") +
-                  std::to_string(As<Number>(As<Cell>(obj)->GetSecond())->GetValue());
-    } else if (Is<Symbol>(As<Cell>(obj)->GetSecond())) {
-        result += (As<Cell>(obj)->GetFirst() ? " . " : "") +
-                  As<Symbol>(As<Cell>(obj)->GetSecond())->GetName();
-    } else if (Is<Boolean>(As<Cell>(obj)->GetSecond())) {
-        result += (As<Cell>(obj)->GetFirst() ? " . " : "");
-        result += (As<Boolean>(As<Cell>(obj)->GetSecond())->GetValue() ? "#t" : "#f");
-    } else if (Is<Cell>(As<Cell>(obj)->GetSecond())) {
-        result += (As<Cell>(obj)->GetFirst() ? " " : "") + PrintCell(As<Cell>(obj)->GetSecond());
-    }
-    return result;
-}
+#include <algorithm>
+#include <chrono>
+#include <utility>
 
-std::string Interpreter::Run(const std::string str) {
-    std::stringstream ss{str};
-    Tokenizer tokenizer{&ss};
-    auto obj = Read(&tokenizer);
-    if (!tokenizer.IsEnd()) {
-        throw SyntaxError();
+namespace {
+
+// Reads a program in place, without copying it into a stream.
+class ProgramBuffer : public std::streambuf {
+public:
+    void Reset(std::string_view program) {
+        auto data = const_cast<char*>(program.data());
+        setg(data, data, data + program.size());
     }
-    if (!obj) {
+};
+
+// Lists are only printed when a procedure returned them: a list of data evaluated element by
+// element is an error.
+bool IsPrintable(const std::shared_ptr<Object>& result, bool applied) {
+    if (!result || Is<Number>(result) || Is<Boolean>(result) || Is<Vector>(result) ||
+        Is<Promise>(result) || Is<String>(result) || Is<HashTable>(result)) {
+        return true;
+    }
+    return Is<Cell>(result) && applied;
+}
+
+std::string PrintResult(const std::shared_ptr<Object>& result, bool applied) {
+    if (!IsPrintable(result, applied)) {
         throw RuntimeError();
     }
-    auto result = obj->Eval();
+    std::string out;
+    Print(result, &out);
+    return out;
+}
+
+}  // namespace
+
+Status Interpreter::Evaluate(std::istream* in, bool all, std::vector<std::string>* results) {
+    BudgetGuard budget_guard(limits_);
+    StatsGuard stats_guard(&stats_);
+    // Records the peak heap and the times of the run, also when it fails.
+    struct RunRecorder {
+        ~RunRecorder() {
+            interpreter->last_peak_ = interpreter->heap_.GetPeak();
+            if (interpreter->profile_) {
+                interpreter->profile_->AddRun(interpreter->last_peak_);
+            }
+            interpreter->stats_.AddRun(failed, parse_time, eval_time, interpreter->last_peak_);
+        }
+
+        Interpreter* interpreter;
+        bool failed = true;
+        std::chrono::nanoseconds parse_time{};
+        std::chrono::nanoseconds eval_time{};
+    } run_recorder{this};
+    auto lap = [last = std::chrono::steady_clock::now()]() mutable {
+        auto now = std::chrono::steady_clock::now();
+        return now - std::exchange(last, now);
+    };
+    heap_.ResetPeak();
+    auto phase = [this](const char* name) { return profile_ ? name : nullptr; };
+    AllocationSiteGuard site_guard(phase("read"));
+    Tokenizer tokenizer{in, std::nothrow};
+    if (tokenizer.IsEnd()) {
+        return {ErrorKind::SYNTAX, tokenizer.GetOffset()};
+    }
+    // The whole program is read first, so a syntax error anywhere leaves the globals untouched.
+    std::vector<std::shared_ptr<Object>> forms;
+    std::vector<size_t> offsets;
+    while (!tokenizer.IsEnd()) {
+        offsets.push_back(tokenizer.GetOffset());
+        auto form = TryRead(&tokenizer);
+        if (!form) {
+            return form;
+        }
+        forms.push_back(std::move(form.value));
+    }
+    run_recorder.parse_time += lap();
+    SamplingGuard sampling_guard(sampler_.get());
+    for (size_t i = 0; i < forms.size(); ++i) {
+        try {
+            allocation_site = phase("optimize");
+            auto form = Optimize(std::move(forms[i]));
+            if (!form) {
+                return {ErrorKind::RUNTIME, offsets[i]};
+            }
+            run_recorder.parse_time += lap();
+            allocation_site = phase("eval");
+            bool applied = true;
+            auto result = Is<Cell>(form) ? As<Cell>(form)->EvalForm(&applied) : form->Eval();
+            if (all || i + 1 == forms.size()) {
+                allocation_site = phase("print");
+                results->push_back(PrintResult(result, applied));
+            }
+            run_recorder.eval_time += lap();
+        } catch (const std::exception& error) {
+            auto kind = GetErrorKind(error);
+            if (kind == ErrorKind::NONE) {
+                throw;
+            }
+            return {kind, offsets[i]};
+        }
+    }
+    run_recorder.failed = false;
+    return {};
+}
+
+void Interpreter::EnableProfiling() {
+    if (!profile_) {
+        profile_ = std::make_unique<AllocationProfile>();
+        heap_.SetProfile(profile_.get());
+    }
+}
+
+void Interpreter::EnableSampling(int64_t interval) {
+    if (!sampler_) {
+        sampler_ = std::make_unique<Sampler>(std::max<int64_t>(interval, 1));
+    }
+}
+
+InterpreterStats Interpreter::GetStats() const {
+    auto stats = stats_.Get();
+    stats.heap_bytes = heap_.GetUsed();
+    return stats;
+}
+
+void Interpreter::ExportMetrics(const std::string& path, std::chrono::milliseconds period) {
+    exporter_.reset();
+    exporter_ = std::make_unique<MetricsExporter>(path, period,
+                                                  [this] { return ToPrometheus(GetStats()); });
+}
+
+std::string Interpreter::Run(const std::string str) {
+    auto result = TryRun(str);
     if (!result) {
-        return "()";
-    } else if (Is<Number>(result)) {
-        return std::to_string(As<Number>(result)->GetValue());
-    } else if (Is<Boolean>(result)) {
-        return As<Boolean>(result)->GetValue() ? "#t" : "#f";
-    } else if (Is<Cell>(result) && As<Cell>(obj)->GetFirst() &&
-               Is<Function>(As<Cell>(obj)->GetFirst()->Eval())) {
-        return "(" + PrintCell(result) + ")";
-    } else {
-        throw RuntimeError();
+        ThrowError(result.error);
+    }
+    return std::move(result.value);
+}
+
+Result<std::string> Interpreter::TryRun(std::string_view program) {
+    EnvironmentGuard environment_guard(environment_.get());
+    PoolGuard pool_guard(pool_.get());
+    HeapGuard heap_guard(&heap_);
+    std::vector<std::string> results;
+    ProgramBuffer buffer;
+    buffer.Reset(program);
+    std::istream in(&buffer);
+    if (auto status = Evaluate(&in, false, &results); !status) {
+        return status;
+    }
+    return std::move(results.back());
+}
+
+std::vector<std::string> Interpreter::RunAll(const std::string& program) {
+    EnvironmentGuard environment_guard(environment_.get());
+    PoolGuard pool_guard(pool_.get());
+    HeapGuard heap_guard(&heap_);
+    std::vector<std::string> results;
+    ProgramBuffer buffer;
+    buffer.Reset(program);
+    std::istream in(&buffer);
+    if (auto status = Evaluate(&in, true, &results); !status) {
+        ThrowError(status.error);
     }
+    return results;
+}
+
+std::vector<std::string> Interpreter::RunBatch(std::span<const std::string> programs) {
+    EnvironmentGuard environment_guard(environment_.get());
+    PoolGuard pool_guard(pool_.get());
+    HeapGuard heap_guard(&heap_);
+    std::vector<std::string> results;
+    results.reserve(programs.size());
+    ProgramBuffer buffer;
+    std::istream in(&buffer);
+    for (const auto& program : programs) {
+        buffer.Reset(program);
+        in.clear();
+        if (auto status = Evaluate(&in, false, &results); !status) {
+            ThrowError(status.error);
+        }
+    }
+    return results;
+}
+
+// Outside any heap: like the builtins, the prelude is part of every interpreter and is not
+// charged to it.
+void Interpreter::LoadPrelude() {
+    if (auto image = GetPreludeImage(); !image.empty()) {
+        EnvironmentGuard environment_guard(environment_.get());
+        ReadSnapshot(environment_.get(), image);
+    }
+}
+
+void Interpreter::Reset() {
+    // Futures that were never touched may still be running in the old environment.
+    while (pool_->IsBusy()) {
+        if (!pool_->RunPending()) {
+            std::this_thread::yield();
+        }
+    }
+    environment_ = std::make_unique<Environment>();
+    LoadPrelude();
+}
+
+void Interpreter::SaveSnapshot(const std::string& path) {
+    WriteSnapshot(environment_.get(), path);
+}
+
+void Interpreter::LoadSnapshot(const std::string& path) {
+    EnvironmentGuard environment_guard(environment_.get());
+    HeapGuard heap_guard(&heap_);
+    ReadSnapshot(environment_.get(), path);
 }
@@ -1,12 +1,130 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <span>
 #include <sstream>
+#include <string_view>
+#include <thread>
+#include <vector>
 
+#include "budget.h"
+#include "optimizer.h"
+#include "parallel.h"
 #include "parser.h"
+#include "profile.h"
+#include "sampler.h"
+#include "stats.h"
 
+// Interpreters are isolates: each one owns its global environment, the code it has read with
+// the caches in it, and its task pool. Builtins are immutable and shared. Different
+// interpreters can run on different threads without synchronizing; a single interpreter runs
+// on one thread at a time.
 class Interpreter {
 public:
-    Interpreter() = default;
+    Interpreter() : Interpreter(std::thread::hardware_concurrency()) {
+    }
 
+    // With no workers, pmap and future run on the calling thread.
+    explicit Interpreter(size_t workers)
+        : environment_(std::make_unique<Environment>()),
+          pool_(std::make_unique<TaskPool>(workers)) {
+        LoadPrelude();
+    }
+
+    // Evaluates every top-level form of the program in order and returns the result of the last
+    // one.
     std::string Run(const std::string);
+
+    // Same as Run, but returns errors instead of throwing them, with the offset in the program
+    // of the form that failed, or of the malformed input. Malformed programs are rejected
+    // without throwing at all; errors raised during evaluation are caught at the form.
+    Result<std::string> TryRun(std::string_view program);
+
+    // Same as Run, but returns the result of every form.
+    std::vector<std::string> RunAll(const std::string& program);
+
+    // Runs the programs one after another, as with Run, sharing the setup of the runs. The first
+    // error is thrown after the programs before it have taken effect.
+    std::vector<std::string> RunBatch(std::span<const std::string> programs);
+
+    // Saves the globals defined so far, with everything reachable from them, to a snapshot.
+    void SaveSnapshot(const std::string& path);
+
+    // Defines the globals saved in a snapshot, as if the code that built them had been run.
+    void LoadSnapshot(const std::string& path);
+
+    // Drops every global defined so far, by programs or snapshots, leaving the interpreter as
+    // it was created. Limits, profiles, samples and counters are kept. Waits for the tasks of
+    // earlier runs; must not be called while the interpreter runs.
+    void Reset();
+
+    // Every later run raises LimitError once it evaluates more than max_steps procedure
+    // applications or nests deeper than max_depth, or once the interpreter holds more than
+    // max_heap_bytes of live objects. The interpreter stays usable after the error.
+    void SetLimits(const Limits& limits) {
+        limits_ = limits;
+        heap_.SetLimit(limits.max_heap_bytes);
+    }
+
+    // Bytes of the objects currently alive in this interpreter.
+    size_t GetHeapUsed() const {
+        return heap_.GetUsed();
+    }
+
+    // Most bytes of live objects at any point of the last run.
+    size_t GetLastRunPeak() const {
+        return last_peak_;
+    }
+
+    // Starts recording the allocations of the interpreter by the type of object and by the
+    // builtin or phase that made them. Every procedure application pays a lookup while
+    // profiling. Must not be called while the interpreter runs.
+    void EnableProfiling();
+
+    // Nullptr unless profiling is enabled.
+    const AllocationProfile* GetProfile() const {
+        return profile_.get();
+    }
+
+    // Starts sampling the call stacks of the interpreter's programs every `interval` steps, for
+    // flamegraphs of where they spend their time. Must not be called while the interpreter runs.
+    void EnableSampling(int64_t interval = 1000);
+
+    // Nullptr unless sampling is enabled.
+    const Sampler* GetSampler() const {
+        return sampler_.get();
+    }
+
+    // Counters of every run so far. Cheap to keep, so they are always on; safe to call while
+    // the interpreter runs on another thread.
+    InterpreterStats GetStats() const;
+
+    // Writes GetStats() in the Prometheus text format to `path` every period, until the
+    // interpreter is destroyed or the export is started again.
+    void ExportMetrics(const std::string& path,
+                       std::chrono::milliseconds period = std::chrono::seconds(10));
+
+    // Lists shorter than the grain are mapped by pmap sequentially.
+    void SetParallelGrain(size_t grain) {
+        pool_->SetGrain(grain);
+    }
+
+private:
+    void LoadPrelude();
+
+    Status Evaluate(std::istream* in, bool all, std::vector<std::string>* results);
+
+    // Declared first, so it outlives every object charged to it.
+    Heap heap_;
+    // Outlives the objects, which are recorded in it when they are freed.
+    std::unique_ptr<AllocationProfile> profile_;
+    std::unique_ptr<Sampler> sampler_;
+    StatsCollector stats_;
+    Limits limits_;
+    size_t last_peak_ = 0;
+    std::unique_ptr<Environment> environment_;
+    std::unique_ptr<MetricsExporter> exporter_;
+    // Declared last, so workers are joined before the environment goes away.
+    std::unique_ptr<TaskPool> pool_;
 };
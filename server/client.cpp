@@ -0,0 +1,164 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "latency.h"
+#include "protocol.h"
+
+namespace {
+
+struct Options {
+    std::string socket = "/tmp/scheme.sock";
+    size_t connections = 1;
+    size_t requests = 0;
+    std::vector<std::string> programs;
+};
+
+int Connect(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool Eval(int fd, std::string_view program, protocol::Status* status, std::string* payload) {
+    std::string request;
+    protocol::AppendRequest(&request, program);
+    return protocol::WriteAll(fd, request) && protocol::ReadResponse(fd, status, payload);
+}
+
+// Sends every line of stdin as a request and prints the responses.
+int Interactive(const Options& options) {
+    int fd = Connect(options.socket);
+    if (fd < 0) {
+        std::cerr << "scheme-client: " << options.socket << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    std::string line;
+    std::string payload;
+    protocol::Status status;
+    bool failed = false;
+    while (std::getline(std::cin, line)) {
+        if (line.find_first_not_of(" \t\r") == line.npos) {
+            continue;
+        }
+        if (!Eval(fd, line, &status, &payload)) {
+            std::cerr << "scheme-client: connection lost\n";
+            return 1;
+        }
+        std::cout << (status == protocol::OK ? "" : "error: ") << payload << "\n";
+        failed |= status != protocol::OK;
+    }
+    close(fd);
+    return failed;
+}
+
+// Sends the programs round-robin from several connections at once and reports the latencies
+// seen by the clients.
+int Load(const Options& options) {
+    std::vector<LatencyRecorder> latencies(options.connections);
+    std::atomic<size_t> errors = 0;
+    std::atomic<bool> lost = false;
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.connections; ++i) {
+        threads.emplace_back([&, i] {
+            int fd = Connect(options.socket);
+            if (fd < 0) {
+                lost = true;
+                return;
+            }
+            std::string payload;
+            protocol::Status status;
+            for (size_t j = i; j < options.requests; j += options.connections) {
+                auto sent = std::chrono::steady_clock::now();
+                if (!Eval(fd, options.programs[j % options.programs.size()], &status,
+                          &payload)) {
+                    lost = true;
+                    break;
+                }
+                latencies[i].Add(std::chrono::steady_clock::now() - sent);
+                errors += status != protocol::OK;
+            }
+            close(fd);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LatencyRecorder total;
+    for (const auto& recorder : latencies) {
+        total.Merge(recorder);
+    }
+    std::cout << total.GetCount() << " requests, " << errors << " errors in " << seconds << " s, "
+              << static_cast<int64_t>(total.GetCount() / seconds) << " requests/s\n"
+              << total.Report() << "\n";
+    if (lost) {
+        std::cerr << "scheme-client: connection lost\n";
+    }
+    return lost || errors;
+}
+
+void PrintUsage() {
+    std::cerr << "usage: scheme-client [--socket path] [--connections n] [--requests n] "
+                 "[program...]\n"
+                 "  without --requests, sends every line of stdin and prints the results\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (!arg.starts_with("--")) {
+            options.programs.emplace_back(arg);
+            continue;
+        } else if (i + 1 == argc) {
+            PrintUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--socket") {
+                options.socket = value;
+            } else if (arg == "--connections") {
+                options.connections = std::max<size_t>(std::stoul(value), 1);
+            } else if (arg == "--requests") {
+                options.requests = std::stoul(value);
+            } else {
+                PrintUsage();
+                return 2;
+            }
+        } catch (const std::logic_error&) {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!options.requests) {
+        return Interactive(options);
+    }
+    if (options.programs.empty()) {
+        options.programs.emplace_back("(+ 1 2)");
+    }
+    return Load(options);
+}
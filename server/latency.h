@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Collects request latencies and reports their percentiles.
+class LatencyRecorder {
+public:
+    void Add(std::chrono::steady_clock::duration latency) {
+        samples_.push_back(std::chrono::duration<double, std::micro>(latency).count());
+    }
+
+    void Merge(const LatencyRecorder& other) {
+        samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end());
+    }
+
+    size_t GetCount() const {
+        return samples_.size();
+    }
+
+    std::string Report() {
+        if (samples_.empty()) {
+            return "no requests";
+        }
+        std::sort(samples_.begin(), samples_.end());
+        char line[160];
+        std::snprintf(line, sizeof(line), "p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us",
+                      Percentile(0.5), Percentile(0.9), Percentile(0.99), samples_.back());
+        return line;
+    }
+
+private:
+    double Percentile(double rank) const {
+        return samples_[static_cast<size_t>(rank * (samples_.size() - 1))];
+    }
+
+    std::vector<double> samples_;
+};
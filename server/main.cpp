@@ -0,0 +1,75 @@
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "server.h"
+
+namespace {
+
+void PrintUsage() {
+    std::cerr << "usage: scheme-server [--socket path] [--interpreters n] [--workers n]\n"
+                 "                     [--snapshot path] [--max-steps n] [--max-depth n]\n"
+                 "                     [--max-heap bytes] [--metrics path]\n"
+                 "                     [--idle-timeout seconds]\n"
+                 "  --metrics       write the interpreter counters in the Prometheus text format\n"
+                 "                  to path every 10 seconds\n"
+                 "  --idle-timeout  close connections that send nothing for this long, 60 by\n"
+                 "                  default; 0 keeps them open\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (i + 1 == argc) {
+            PrintUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--socket") {
+                options.socket = value;
+            } else if (arg == "--interpreters") {
+                options.interpreters = std::max<size_t>(std::stoul(value), 1);
+            } else if (arg == "--workers") {
+                options.workers = std::max<size_t>(std::stoul(value), 1);
+            } else if (arg == "--snapshot") {
+                options.snapshot = value;
+            } else if (arg == "--max-steps") {
+                options.limits.max_steps = std::stoull(value);
+            } else if (arg == "--max-depth") {
+                options.limits.max_depth = std::stoul(value);
+            } else if (arg == "--max-heap") {
+                options.limits.max_heap_bytes = std::stoul(value);
+            } else if (arg == "--metrics") {
+                options.metrics = value;
+            } else if (arg == "--idle-timeout") {
+                options.idle_timeout = std::chrono::seconds(std::stoul(value));
+            } else {
+                PrintUsage();
+                return 2;
+            }
+        } catch (const std::logic_error&) {
+            PrintUsage();
+            return 2;
+        }
+    }
+    try {
+        Server server(options);
+        if (!server.Listen()) {
+            std::cerr << "scheme-server: " << options.socket << ": " << std::strerror(errno)
+                      << "\n";
+            return 1;
+        }
+        server.Serve();
+        std::cerr << "scheme-server: " << server.Report() << "\n";
+    } catch (const std::exception& error) {
+        std::cerr << "scheme-server: " << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
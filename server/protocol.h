@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <unistd.h>
+
+// Framing of the eval server. A request is a 4-byte little-endian length followed by the
+// program. A response is a 4-byte little-endian length, a status byte and the payload: the
+// printed result, or the name of the error raised by the program. The length counts the
+// payload only.
+namespace protocol {
+
+constexpr size_t kLengthSize = 4;
+constexpr uint32_t kMaxFrame = 16 << 20;
+
+enum Status : uint8_t { OK = 0, ERROR = 1 };
+
+inline void AppendLength(std::string* out, uint32_t length) {
+    for (size_t i = 0; i < kLengthSize; ++i) {
+        out->push_back(static_cast<char>(length >> (8 * i)));
+    }
+}
+
+inline uint32_t ReadLength(const char* data) {
+    uint32_t length = 0;
+    for (size_t i = 0; i < kLengthSize; ++i) {
+        length |= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return length;
+}
+
+inline void AppendRequest(std::string* out, std::string_view program) {
+    AppendLength(out, program.size());
+    out->append(program);
+}
+
+inline void AppendResponse(std::string* out, Status status, std::string_view payload) {
+    AppendLength(out, payload.size());
+    out->push_back(static_cast<char>(status));
+    out->append(payload);
+}
+
+// Blocking helpers for clients.
+inline bool WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        auto written = write(fd, data.data(), data.size());
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written <= 0) {
+            return false;
+        }
+        data.remove_prefix(written);
+    }
+    return true;
+}
+
+inline bool ReadAll(int fd, char* data, size_t size) {
+    while (size) {
+        auto result = read(fd, data, size);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        } else if (result <= 0) {
+            return false;
+        }
+        data += result;
+        size -= result;
+    }
+    return true;
+}
+
+inline bool ReadResponse(int fd, Status* status, std::string* payload) {
+    char header[kLengthSize + 1];
+    if (!ReadAll(fd, header, sizeof(header))) {
+        return false;
+    }
+    payload->resize(ReadLength(header));
+    *status = static_cast<Status>(header[kLengthSize]);
+    return ReadAll(fd, payload->data(), payload->size());
+}
+
+}  // namespace protocol
@@ -0,0 +1,414 @@
+#include "server.h"
+
+#include <csignal>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+Server::Server(const ServerOptions& options) : options_(options) {
+    for (size_t i = 0; i < options.interpreters; ++i) {
+        interpreters_.push_back(std::make_unique<Interpreter>(0));
+        interpreters_.back()->SetLimits(options.limits);
+        if (!options.snapshot.empty()) {
+            interpreters_.back()->LoadSnapshot(options.snapshot);
+        }
+        free_.push_back(interpreters_.back().get());
+    }
+}
+
+Server::~Server() {
+    {
+        std::lock_guard lock(jobs_mutex_);
+        stop_ = true;
+    }
+    jobs_ready_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    exporter_.reset();
+    for (auto& [id, connection] : connections_) {
+        close(connection.fd);
+    }
+    for (int fd : {listen_fd_, epoll_fd_, event_fd_, signal_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    unlink(options_.socket.c_str());
+}
+
+bool Server::Listen() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options_.socket.size() >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    std::strcpy(address.sun_path, options_.socket.c_str());
+    unlink(options_.socket.c_str());
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0 ||
+        bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(listen_fd_, SOMAXCONN) < 0) {
+        return false;
+    }
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    signal_fd_ = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (epoll_fd_ < 0 || event_fd_ < 0 || signal_fd_ < 0) {
+        return false;
+    }
+    Watch(listen_fd_, kListen, EPOLLIN);
+    Watch(event_fd_, kEvent, EPOLLIN);
+    Watch(signal_fd_, kSignal, EPOLLIN);
+    for (size_t i = 0; i < options_.workers; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+    if (!options_.metrics.empty()) {
+        exporter_ = std::make_unique<MetricsExporter>(
+            options_.metrics, std::chrono::seconds(10), [this] {
+                InterpreterStats total;
+                for (const auto& interpreter : interpreters_) {
+                    total += interpreter->GetStats();
+                }
+                return ToPrometheus(total);
+            });
+    }
+    return true;
+}
+
+void Server::Serve() {
+    std::vector<epoll_event> events(256);
+    // Idle connections are looked for a few times per timeout, at most once a second.
+    auto sweep_period = std::min<std::chrono::milliseconds>(options_.idle_timeout / 4,
+                                                            std::chrono::seconds(1));
+    sweep_period = std::max(sweep_period, std::chrono::milliseconds(1));
+    auto next_sweep = std::chrono::steady_clock::now() + sweep_period;
+    while (!draining_ || !connections_.empty()) {
+        if (!draining_ && stopping_.load(std::memory_order_acquire)) {
+            Drain();
+            continue;
+        }
+        int timeout = options_.idle_timeout.count() ? sweep_period.count() : -1;
+        int count = epoll_wait(epoll_fd_, events.data(), events.size(), timeout);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        for (int i = 0; i < count; ++i) {
+            auto key = events[i].data.u64;
+            if (key == kListen) {
+                Accept();
+            } else if (key == kEvent) {
+                Complete();
+            } else if (key == kSignal) {
+                signalfd_siginfo info;
+                read(signal_fd_, &info, sizeof(info));
+                if (draining_) {
+                    return;
+                }
+                Drain();
+            } else if (auto it = connections_.find(key); it != connections_.end()) {
+                if (events[i].events & EPOLLERR) {
+                    Close(key, &it->second);
+                } else if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+                    Receive(key, &it->second);
+                } else if (events[i].events & EPOLLOUT) {
+                    Progress(key);
+                }
+            }
+        }
+        if (options_.idle_timeout.count() && std::chrono::steady_clock::now() >= next_sweep) {
+            CloseIdle();
+            next_sweep = std::chrono::steady_clock::now() + sweep_period;
+        }
+    }
+}
+
+void Server::Stop() {
+    stopping_.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    write(event_fd_, &one, sizeof(one));
+}
+
+std::string Server::Report() {
+    return std::to_string(latencies_.GetCount()) + " requests, " + std::to_string(errors_) +
+           " errors, " + latencies_.Report();
+}
+
+void Server::Watch(int fd, uint64_t key, uint32_t events, int op) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = key;
+    epoll_ctl(epoll_fd_, op, fd, &event);
+}
+
+void Server::Accept() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        auto id = next_connection_++;
+        auto& connection = connections_.emplace(id, Connection(fd)).first->second;
+        connection.events = EPOLLIN | EPOLLRDHUP;
+        Watch(fd, id, connection.events);
+    }
+}
+
+// Takes in the connections and the requests that have reached the socket already, then closes
+// the listening socket and stops reading. Each connection is closed once the requests it sent
+// have been answered.
+void Server::Drain() {
+    draining_ = true;
+    Accept();
+    close(listen_fd_);
+    listen_fd_ = -1;
+    std::vector<uint64_t> ids;
+    for (const auto& [id, connection] : connections_) {
+        ids.push_back(id);
+    }
+    for (auto id : ids) {
+        Receive(id, &connections_.at(id));
+        if (auto it = connections_.find(id); it != connections_.end()) {
+            it->second.eof = true;
+            Progress(id);
+        }
+    }
+}
+
+void Server::Receive(uint64_t id, Connection* connection) {
+    char block[1 << 16];
+    while (!connection->eof) {
+        auto size = read(connection->fd, block, sizeof(block));
+        if (size > 0) {
+            connection->in.append(block, size);
+            connection->last_active = std::chrono::steady_clock::now();
+        } else if (size == 0) {
+            connection->eof = true;
+        } else if (errno == EAGAIN) {
+            break;
+        } else if (errno != EINTR) {
+            Close(id, connection);
+            return;
+        }
+    }
+    Progress(id);
+}
+
+// Dispatches the next request of the connection, writes what it has to and updates the events
+// it is watched for. A connection whose client has shut down is closed once every complete
+// request it sent has been answered.
+void Server::Progress(uint64_t id) {
+    auto it = connections_.find(id);
+    if (it == connections_.end()) {
+        return;
+    }
+    auto connection = &it->second;
+    if (!Dispatch(id, connection) || !Send(id, connection)) {
+        return;
+    }
+    if (connection->eof && !connection->busy && !connection->waiting &&
+        connection->out.empty()) {
+        Close(id, connection);
+        return;
+    }
+    uint32_t events = 0;
+    if (!connection->eof) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+    // Waits for the socket to drain only while there is something left to write.
+    if (!connection->out.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events != connection->events) {
+        // Hangups are reported whatever the events, so a socket with nothing to wait for is
+        // taken out of the set until it has something to write again.
+        int op = !connection->events ? EPOLL_CTL_ADD : !events ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+        Watch(connection->fd, id, events, op);
+        connection->events = events;
+    }
+}
+
+// Hands the next complete request of the connection to the workers. Returns false when the
+// connection was closed.
+bool Server::Dispatch(uint64_t id, Connection* connection) {
+    if (connection->busy || connection->waiting ||
+        connection->in.size() < protocol::kLengthSize) {
+        return true;
+    }
+    auto length = protocol::ReadLength(connection->in.data());
+    if (length > protocol::kMaxFrame) {
+        Close(id, connection);
+        return false;
+    } else if (connection->in.size() < protocol::kLengthSize + length) {
+        return true;
+    }
+    if (!connection->interpreter) {
+        if (free_.empty()) {
+            connection->waiting = true;
+            waiting_.push_back(id);
+            return true;
+        }
+        connection->interpreter = free_.back();
+        free_.pop_back();
+    }
+    Job job{id, connection->interpreter, connection->in.substr(protocol::kLengthSize, length),
+            false};
+    connection->in.erase(0, protocol::kLengthSize + length);
+    connection->busy = true;
+    connection->start = std::chrono::steady_clock::now();
+    Submit(std::move(job));
+    return true;
+}
+
+void Server::Complete() {
+    uint64_t count;
+    while (read(event_fd_, &count, sizeof(count)) > 0) {
+    }
+    std::deque<Completion> completions;
+    {
+        std::lock_guard lock(completions_mutex_);
+        completions.swap(completions_);
+    }
+    for (auto& completion : completions) {
+        if (completion.reset) {
+            Release(completion.interpreter);
+            continue;
+        }
+        auto it = connections_.find(completion.connection);
+        if (it == connections_.end()) {
+            Recycle(completion.interpreter);
+            continue;
+        }
+        auto& connection = it->second;
+        latencies_.Add(std::chrono::steady_clock::now() - connection.start);
+        errors_ += completion.status != protocol::OK;
+        protocol::AppendResponse(&connection.out, completion.status, completion.payload);
+        connection.busy = false;
+        connection.last_active = std::chrono::steady_clock::now();
+        Progress(completion.connection);
+    }
+}
+
+// Writes as much of the pending output as the socket takes. Returns false when the connection
+// was closed.
+bool Server::Send(uint64_t id, Connection* connection) {
+    size_t written = 0;
+    while (written < connection->out.size()) {
+        auto result = write(connection->fd, connection->out.data() + written,
+                            connection->out.size() - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        } else if (result < 0 && errno == EAGAIN) {
+            break;
+        } else if (result < 0) {
+            Close(id, connection);
+            return false;
+        }
+        written += result;
+    }
+    connection->out.erase(0, written);
+    return true;
+}
+
+// Closes the connections that have neither a request in flight nor sent anything for the idle
+// timeout, returning their interpreters to the pool.
+void Server::CloseIdle() {
+    auto deadline = std::chrono::steady_clock::now() - options_.idle_timeout;
+    std::vector<uint64_t> idle;
+    for (const auto& [id, connection] : connections_) {
+        if (!connection.busy && !connection.waiting && connection.last_active < deadline) {
+            idle.push_back(id);
+        }
+    }
+    for (auto id : idle) {
+        Close(id, &connections_.at(id));
+    }
+}
+
+void Server::Close(uint64_t id, Connection* connection) {
+    close(connection->fd);
+    // A running program returns the interpreter once it completes.
+    if (connection->interpreter && !connection->busy) {
+        Recycle(connection->interpreter);
+    }
+    if (connection->waiting) {
+        std::erase(waiting_, id);
+    }
+    connections_.erase(id);
+}
+
+// Resets an interpreter given up by a connection on a worker before it is handed out again,
+// so that no client sees the definitions of another.
+void Server::Recycle(Interpreter* interpreter) {
+    Submit({0, interpreter, {}, true});
+}
+
+void Server::Release(Interpreter* interpreter) {
+    free_.push_back(interpreter);
+    while (!waiting_.empty() && !free_.empty()) {
+        auto id = waiting_.front();
+        waiting_.pop_front();
+        connections_.at(id).waiting = false;
+        Progress(id);
+    }
+}
+
+void Server::Submit(Job job) {
+    {
+        std::lock_guard lock(jobs_mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    jobs_ready_.notify_one();
+}
+
+void Server::WorkerLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(jobs_mutex_);
+            jobs_ready_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+            // Finishes the jobs left, the last resets among them, before stopping.
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        Completion completion{job.connection, job.interpreter, protocol::OK, {}, job.reset};
+        try {
+            if (job.reset) {
+                job.interpreter->Reset();
+                if (!options_.snapshot.empty()) {
+                    job.interpreter->LoadSnapshot(options_.snapshot);
+                }
+            } else if (auto result = job.interpreter->TryRun(job.program)) {
+                // Malformed requests are rejected without unwinding.
+                completion.payload = std::move(result.value);
+            } else {
+                completion.status = protocol::ERROR;
+                completion.payload = ErrorName(result.error);
+            }
+        } catch (const std::exception& error) {
+            completion.status = protocol::ERROR;
+            completion.payload = error.what();
+        }
+        {
+            std::lock_guard lock(completions_mutex_);
+            completions_.push_back(std::move(completion));
+        }
+        uint64_t one = 1;
+        write(event_fd_, &one, sizeof(one));
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include "../scheme.h"
+#include "latency.h"
+#include "protocol.h"
+
+struct ServerOptions {
+    std::string socket = "/tmp/scheme.sock";
+    size_t interpreters = std::max(std::thread::hardware_concurrency(), 1u);
+    size_t workers = std::max(std::thread::hardware_concurrency(), 1u);
+    std::string snapshot;
+    std::string metrics;
+    Limits limits;
+    // Connections that send nothing for this long are closed. Zero keeps them open.
+    std::chrono::milliseconds idle_timeout = std::chrono::seconds(60);
+};
+
+// Serves eval requests from a Unix socket. One thread runs the epoll loop and does all the IO;
+// programs run on the workers. A connection runs its requests one at a time in the order they
+// arrive, so pipelined requests are answered in order. Every connection gets an interpreter of
+// its own, which is reset before the next connection gets it.
+class Server {
+public:
+    explicit Server(const ServerOptions& options);
+
+    ~Server();
+
+    bool Listen();
+
+    // Once SIGINT or SIGTERM arrives or Stop is called, stops accepting and reading, answers the
+    // requests already received and returns when every answer has been written. A second signal
+    // makes it return at once.
+    void Serve();
+
+    // Makes Serve drain and return. Safe to call from any thread once Listen has succeeded.
+    void Stop();
+
+    std::string Report();
+
+private:
+    struct Job {
+        uint64_t connection;
+        Interpreter* interpreter;
+        std::string program;
+        // Resets the interpreter instead of running a program.
+        bool reset = false;
+    };
+
+    struct Completion {
+        uint64_t connection;
+        Interpreter* interpreter;
+        protocol::Status status;
+        std::string payload;
+        bool reset = false;
+    };
+
+    struct Connection {
+        explicit Connection(int fd) : fd(fd), last_active(std::chrono::steady_clock::now()) {
+        }
+
+        int fd;
+        std::string in;
+        std::string out;
+        // Checked out from the pool by the first request and kept until the connection closes,
+        // so the definitions of a client stay visible to its later requests.
+        Interpreter* interpreter = nullptr;
+        bool busy = false;
+        bool waiting = false;
+        // The client has shut down its side; requests already received are still answered.
+        bool eof = false;
+        // Events the socket is watched for, zero once it is not watched at all.
+        uint32_t events = 0;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point last_active;
+    };
+
+    static constexpr uint64_t kListen = 0;
+    static constexpr uint64_t kEvent = 1;
+    static constexpr uint64_t kSignal = 2;
+
+    void Watch(int fd, uint64_t key, uint32_t events, int op = EPOLL_CTL_ADD);
+    void Accept();
+    void Drain();
+    void Receive(uint64_t id, Connection* connection);
+    void Progress(uint64_t id);
+    bool Dispatch(uint64_t id, Connection* connection);
+    void Complete();
+    bool Send(uint64_t id, Connection* connection);
+    void CloseIdle();
+    void Close(uint64_t id, Connection* connection);
+    void Recycle(Interpreter* interpreter);
+    void Release(Interpreter* interpreter);
+    void Submit(Job job);
+    void WorkerLoop();
+
+    ServerOptions options_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int event_fd_ = -1;
+    int signal_fd_ = -1;
+    std::atomic<bool> stopping_ = false;
+    bool draining_ = false;
+
+    std::vector<std::unique_ptr<Interpreter>> interpreters_;
+    std::vector<Interpreter*> free_;
+    std::deque<uint64_t> waiting_;
+    std::unordered_map<uint64_t, Connection> connections_;
+    uint64_t next_connection_ = kSignal + 1;
+
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_ready_;
+    std::deque<Job> jobs_;
+    bool stop_ = false;
+    std::mutex completions_mutex_;
+    std::deque<Completion> completions_;
+    std::vector<std::thread> workers_;
+    std::unique_ptr<MetricsExporter> exporter_;
+
+    LatencyRecorder latencies_;
+    size_t errors_ = 0;
+};
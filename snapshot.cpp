@@ -0,0 +1,529 @@
+#include "snapshot.h"
+#include "hashtable.h"
+#include "memoize.h"
+#include "stream.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'C', 'M', 'S', 'N', 'A', 'P', '1'};
+
+enum class Kind : uint32_t {
+    NUMBER,
+    BOOLEAN,
+    SYMBOL,
+    BUILTIN,
+    CELL,
+    VECTOR,
+    SCOPE,
+    CLOSURE,
+    MEMOIZED,
+    PROMISE,
+    STRING,
+    HASH_TABLE
+};
+
+// The file is the header, the records, the globals as pairs of a name and a reference, and the
+// data area holding names and lists of references. References are 1-based record indices, with
+// 0 standing for the empty list; names are offsets into the data area.
+struct Header {
+    char magic[8];
+    uint32_t record_count;
+    uint32_t global_count;
+    uint32_t data_size;
+    uint32_t reserved;
+};
+
+// The payload is the value of a number or a boolean, and an offset into the data area otherwise.
+struct Record {
+    Kind kind;
+    uint32_t size;
+    uint64_t payload;
+};
+
+class Writer {
+public:
+    Writer() {
+        for (const auto& [name, function] : GetBuiltins()) {
+            builtin_names_[function.get()] = name;
+        }
+    }
+
+    void AddGlobal(const std::string& name, const std::shared_ptr<Object>& value) {
+        globals_.push_back(PutString(name));
+        globals_.push_back(Add(value));
+    }
+
+    void Save(const std::string& path) {
+        while (!pending_objects_.empty() || !pending_scopes_.empty()) {
+            if (!pending_objects_.empty()) {
+                auto [id, obj] = std::move(pending_objects_.back());
+                pending_objects_.pop_back();
+                records_[id - 1] = Encode(obj);
+            } else {
+                auto [id, scope] = std::move(pending_scopes_.back());
+                pending_scopes_.pop_back();
+                records_[id - 1] = Encode(scope);
+            }
+        }
+        Header header;
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.record_count = records_.size();
+        header.global_count = globals_.size() / 2;
+        header.data_size = data_.size();
+        header.reserved = 0;
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records_.data()), records_.size() * sizeof(Record));
+        out.write(reinterpret_cast<const char*>(globals_.data()),
+                  globals_.size() * sizeof(uint32_t));
+        out.write(data_.data(), data_.size());
+        if (!out) {
+            throw RuntimeError();
+        }
+    }
+
+private:
+    uint32_t Add(const std::shared_ptr<Object>& obj) {
+        if (!obj) {
+            return 0;
+        }
+        auto [it, inserted] = ids_.emplace(obj.get(), records_.size() + 1);
+        if (inserted) {
+            records_.emplace_back();
+            pending_objects_.emplace_back(it->second, obj);
+        }
+        return it->second;
+    }
+
+    uint32_t Add(const std::shared_ptr<Scope>& scope) {
+        if (!scope) {
+            return 0;
+        }
+        auto [it, inserted] = ids_.emplace(scope.get(), records_.size() + 1);
+        if (inserted) {
+            records_.emplace_back();
+            pending_scopes_.emplace_back(it->second, scope);
+        }
+        return it->second;
+    }
+
+    uint32_t PutString(const std::string& str) {
+        auto [it, inserted] = strings_.emplace(str, data_.size());
+        if (inserted) {
+            uint32_t size = str.size();
+            data_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+            data_.append(str);
+            data_.resize((data_.size() + 3) / 4 * 4);
+        }
+        return it->second;
+    }
+
+    uint32_t PutWords(const std::vector<uint32_t>& words) {
+        uint32_t offset = data_.size();
+        data_.append(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+        return offset;
+    }
+
+    Record Encode(const std::shared_ptr<Object>& obj) {
+        if (Is<Number>(obj)) {
+            return {Kind::NUMBER, 0, std::bit_cast<uint64_t>(As<Number>(obj)->GetValue())};
+        } else if (Is<Boolean>(obj)) {
+            return {Kind::BOOLEAN, 0, As<Boolean>(obj)->GetValue()};
+        } else if (Is<Symbol>(obj)) {
+            return {Kind::SYMBOL, 0, PutString(As<Symbol>(obj)->GetName())};
+        } else if (Is<String>(obj)) {
+            return {Kind::STRING, 0, PutString(std::string(As<String>(obj)->GetView()))};
+        } else if (auto it = builtin_names_.find(obj.get()); it != builtin_names_.end()) {
+            return {Kind::BUILTIN, 0, PutString(it->second)};
+        } else if (Is<Cell>(obj)) {
+            std::vector<uint32_t> words{Add(As<Cell>(obj)->GetFirst()),
+                                        Add(As<Cell>(obj)->GetSecond())};
+            return {Kind::CELL, 0, PutWords(words)};
+        } else if (Is<Vector>(obj)) {
+            std::vector<uint32_t> words;
+            for (const auto& element : As<Vector>(obj)->GetElements()) {
+                words.push_back(Add(element));
+            }
+            return {Kind::VECTOR, static_cast<uint32_t>(words.size()), PutWords(words)};
+        } else if (Is<HashTable>(obj)) {
+            std::vector<uint32_t> words;
+            for (const auto& [key, value] : As<HashTable>(obj)->GetEntries()) {
+                words.push_back(Add(key));
+                words.push_back(Add(value));
+            }
+            return {Kind::HASH_TABLE, static_cast<uint32_t>(words.size() / 2), PutWords(words)};
+        } else if (Is<Closure>(obj)) {
+            auto closure = As<Closure>(obj);
+            std::vector<uint32_t> words{Add(closure->GetScope()),
+                                        static_cast<uint32_t>(closure->GetBody().size())};
+            for (const auto& param : closure->GetParams()) {
+                words.push_back(PutString(param));
+            }
+            for (const auto& expr : closure->GetBody()) {
+                words.push_back(Add(expr));
+            }
+            return {Kind::CLOSURE, static_cast<uint32_t>(closure->GetParams().size()),
+                    PutWords(words)};
+        } else if (Is<Memoized>(obj)) {
+            auto memoized = As<Memoized>(obj);
+            uint64_t capacity = memoized->GetCapacity();
+            std::vector<uint32_t> words{Add(memoized->GetFunction()),
+                                        static_cast<uint32_t>(capacity),
+                                        static_cast<uint32_t>(capacity >> 32)};
+            return {Kind::MEMOIZED, 0, PutWords(words)};
+        } else if (Is<Promise>(obj)) {
+            auto [thunk, value] = As<Promise>(obj)->GetState();
+            std::vector<uint32_t> words{Add(thunk), Add(value)};
+            return {Kind::PROMISE, 0, PutWords(words)};
+        } else {
+            throw RuntimeError();
+        }
+    }
+
+    Record Encode(const std::shared_ptr<Scope>& scope) {
+        std::vector<uint32_t> words{Add(scope->GetParent())};
+        for (const auto& [name, binding] : scope->GetVariables()) {
+            words.push_back(PutString(name));
+            words.push_back(Add(binding.value));
+        }
+        return {Kind::SCOPE, static_cast<uint32_t>(scope->GetVariables().size()), PutWords(words)};
+    }
+
+    std::unordered_map<const Object*, std::string> builtin_names_;
+    std::unordered_map<const void*, uint32_t> ids_;
+    std::vector<std::pair<uint32_t, std::shared_ptr<Object>>> pending_objects_;
+    std::vector<std::pair<uint32_t, std::shared_ptr<Scope>>> pending_scopes_;
+    std::vector<Record> records_;
+    std::vector<uint32_t> globals_;
+    std::unordered_map<std::string, uint32_t> strings_;
+    std::string data_;
+};
+
+class Mapping {
+public:
+    explicit Mapping(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw RuntimeError();
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_ = st.st_size;
+            void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            data_ = addr == MAP_FAILED ? nullptr : static_cast<const char*>(addr);
+        }
+        close(fd);
+        if (!data_) {
+            throw RuntimeError();
+        }
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    ~Mapping() {
+        munmap(const_cast<char*>(data_), size_);
+    }
+
+    const char* GetData() const {
+        return data_;
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Every offset, size and reference read from the file is checked, and any inconsistency raises
+// RuntimeError.
+class Reader {
+public:
+    Reader(const char* data, size_t size) {
+        // Records are read in place and hold 64-bit payloads.
+        if (size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % alignof(Record)) {
+            throw RuntimeError();
+        }
+        std::memcpy(&header_, data, sizeof(header_));
+        if (std::memcmp(header_.magic, kMagic, sizeof(kMagic)) != 0) {
+            throw RuntimeError();
+        }
+        uint64_t records_size = uint64_t{header_.record_count} * sizeof(Record);
+        uint64_t globals_size = uint64_t{header_.global_count} * 2 * sizeof(uint32_t);
+        if (sizeof(Header) + records_size + globals_size + header_.data_size != size) {
+            throw RuntimeError();
+        }
+        records_ = reinterpret_cast<const Record*>(data + sizeof(Header));
+        globals_ = reinterpret_cast<const uint32_t*>(data + sizeof(Header) + records_size);
+        data_ = data + sizeof(Header) + records_size + globals_size;
+        objects_.resize(header_.record_count + 1);
+        scopes_.resize(header_.record_count + 1);
+        visiting_.resize(header_.record_count + 1);
+    }
+
+    void Load(Environment* environment) {
+        for (uint32_t id = 1; id <= header_.record_count; ++id) {
+            MakeShell(id);
+        }
+        for (uint32_t id = 1; id <= header_.record_count; ++id) {
+            Build(id);
+        }
+        for (uint32_t id = 1; id <= header_.record_count; ++id) {
+            FillShell(id);
+        }
+        // Keys are hashed by their contents, so tables are filled after the other shells.
+        for (uint32_t id = 1; id <= header_.record_count; ++id) {
+            FillTable(id);
+        }
+        for (uint32_t i = 0; i < header_.global_count; ++i) {
+            auto name = GetString(globals_[2 * i]);
+            auto value = Get(globals_[2 * i + 1]);
+            if (Is<Closure>(value) && As<Closure>(value)->GetName().empty()) {
+                As<Closure>(value)->SetName(name);
+            }
+            environment->Define(name, value);
+        }
+    }
+
+private:
+    const Record& GetRecord(uint32_t id) const {
+        if (id == 0 || id > header_.record_count) {
+            throw RuntimeError();
+        }
+        return records_[id - 1];
+    }
+
+    const uint32_t* GetWords(uint64_t offset, uint64_t count) const {
+        if (offset % sizeof(uint32_t) || offset > header_.data_size ||
+            count > (header_.data_size - offset) / sizeof(uint32_t)) {
+            throw RuntimeError();
+        }
+        return reinterpret_cast<const uint32_t*>(data_ + offset);
+    }
+
+    std::string GetString(uint64_t offset) const {
+        uint32_t size = *GetWords(offset, 1);
+        if (size > header_.data_size - offset - sizeof(uint32_t)) {
+            throw RuntimeError();
+        }
+        return std::string(data_ + offset + sizeof(uint32_t), size);
+    }
+
+    std::shared_ptr<Object> Get(uint32_t id) const {
+        if (id == 0) {
+            return nullptr;
+        }
+        GetRecord(id);
+        if (!objects_[id]) {
+            throw RuntimeError();
+        }
+        return objects_[id];
+    }
+
+    std::shared_ptr<Scope> GetScope(uint32_t id) const {
+        if (id == 0) {
+            return nullptr;
+        }
+        GetRecord(id);
+        if (!scopes_[id]) {
+            throw RuntimeError();
+        }
+        return scopes_[id];
+    }
+
+    // Pairs, vectors, hash tables, scopes and promises can take part in cycles, so they are
+    // created empty first and filled once everything else exists.
+    void MakeShell(uint32_t id) {
+        const auto& record = GetRecord(id);
+        if (record.kind == Kind::CELL) {
+            objects_[id] = Make<Cell>(nullptr, nullptr);
+        } else if (record.kind == Kind::VECTOR) {
+            objects_[id] = Make<Vector>(std::vector<std::shared_ptr<Object>>{});
+        } else if (record.kind == Kind::HASH_TABLE) {
+            objects_[id] = Make<HashTable>();
+        } else if (record.kind == Kind::PROMISE) {
+            objects_[id] = Make<Promise>(nullptr);
+        } else if (record.kind == Kind::SCOPE) {
+            std::vector<uint32_t> chain;
+            for (auto cur = id; cur && !scopes_[cur]; cur = *GetWords(GetRecord(cur).payload, 1)) {
+                if (GetRecord(cur).kind != Kind::SCOPE || chain.size() > header_.record_count) {
+                    throw RuntimeError();
+                }
+                chain.push_back(cur);
+            }
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                auto parent = *GetWords(GetRecord(*it).payload, 1);
+                scopes_[*it] = Make<Scope>(GetScope(parent));
+            }
+        }
+    }
+
+    std::vector<uint32_t> GetDependencies(uint32_t id) const {
+        const auto& record = GetRecord(id);
+        if (record.kind == Kind::CLOSURE) {
+            auto body_size = GetWords(record.payload, 2)[1];
+            auto words = GetWords(record.payload, 2 + uint64_t{record.size} + body_size);
+            return {words + 2 + record.size, words + 2 + record.size + body_size};
+        } else if (record.kind == Kind::MEMOIZED) {
+            return {*GetWords(record.payload, 1)};
+        } else {
+            return {};
+        }
+    }
+
+    // Builds everything but the shells after the objects they contain, without recursion.
+    void Build(uint32_t root) {
+        std::vector<std::pair<uint32_t, bool>> stack{{root, false}};
+        while (!stack.empty()) {
+            auto [id, expanded] = stack.back();
+            stack.pop_back();
+            if (id == 0 || objects_[id] || GetRecord(id).kind == Kind::SCOPE) {
+                continue;
+            }
+            if (expanded) {
+                objects_[id] = Construct(id);
+                continue;
+            }
+            // Only shells may be part of a cycle.
+            if (visiting_[id]) {
+                throw RuntimeError();
+            }
+            visiting_[id] = true;
+            stack.emplace_back(id, true);
+            for (auto dependency : GetDependencies(id)) {
+                stack.emplace_back(dependency, false);
+            }
+        }
+    }
+
+    std::shared_ptr<Object> Construct(uint32_t id) const {
+        const auto& record = GetRecord(id);
+        switch (record.kind) {
+            case Kind::NUMBER:
+                return Make<Number>(std::bit_cast<int64_t>(record.payload));
+            case Kind::BOOLEAN:
+                return Make<Boolean>(record.payload != 0);
+            case Kind::SYMBOL:
+                return Make<Symbol>(GetString(record.payload));
+            case Kind::STRING:
+                return Make<String>(GetString(record.payload));
+            case Kind::BUILTIN: {
+                auto it = GetBuiltins().find(GetString(record.payload));
+                if (it == GetBuiltins().end()) {
+                    throw RuntimeError();
+                }
+                return it->second;
+            }
+            case Kind::CLOSURE: {
+                auto body_size = GetWords(record.payload, 2)[1];
+                auto words = GetWords(record.payload, 2 + uint64_t{record.size} + body_size);
+                std::vector<std::string> params;
+                for (uint32_t i = 0; i < record.size; ++i) {
+                    params.push_back(GetString(words[2 + i]));
+                }
+                std::vector<std::shared_ptr<Object>> body;
+                for (uint32_t i = 0; i < body_size; ++i) {
+                    body.push_back(Get(words[2 + record.size + i]));
+                }
+                return Make<Closure>(std::move(params), std::move(body),
+                                                 GetScope(words[0]));
+            }
+            case Kind::MEMOIZED: {
+                auto words = GetWords(record.payload, 3);
+                auto function = Get(words[0]);
+                uint64_t capacity = words[1] | (uint64_t{words[2]} << 32);
+                if (!Is<Function>(function) || capacity == 0) {
+                    throw RuntimeError();
+                }
+                return Make<Memoized>(As<Function>(function), capacity);
+            }
+            default:
+                throw RuntimeError();
+        }
+    }
+
+    void FillShell(uint32_t id) {
+        const auto& record = GetRecord(id);
+        if (record.kind == Kind::CELL) {
+            auto words = GetWords(record.payload, 2);
+            auto cell = As<Cell>(objects_[id]);
+            cell->SetFirst(Get(words[0]));
+            cell->SetSecond(Get(words[1]));
+        } else if (record.kind == Kind::VECTOR) {
+            auto words = GetWords(record.payload, record.size);
+            auto& elements = As<Vector>(objects_[id])->GetElements();
+            for (uint32_t i = 0; i < record.size; ++i) {
+                elements.push_back(Get(words[i]));
+            }
+        } else if (record.kind == Kind::SCOPE) {
+            auto words = GetWords(record.payload, 1 + 2 * uint64_t{record.size});
+            for (uint32_t i = 0; i < record.size; ++i) {
+                scopes_[id]->Define(GetString(words[1 + 2 * i]), Get(words[2 + 2 * i]));
+            }
+        } else if (record.kind == Kind::PROMISE) {
+            auto words = GetWords(record.payload, 2);
+            auto thunk = Get(words[0]);
+            if (thunk && !Is<Function>(thunk)) {
+                throw RuntimeError();
+            }
+            As<Promise>(objects_[id])->Restore(As<Function>(thunk), Get(words[1]));
+        }
+    }
+
+    void FillTable(uint32_t id) {
+        const auto& record = GetRecord(id);
+        if (record.kind == Kind::HASH_TABLE) {
+            auto words = GetWords(record.payload, 2 * uint64_t{record.size});
+            auto table = As<HashTable>(objects_[id]);
+            for (uint32_t i = 0; i < record.size; ++i) {
+                table->Set(Get(words[2 * i]), Get(words[2 * i + 1]));
+            }
+        }
+    }
+
+    Header header_;
+    const Record* records_;
+    const uint32_t* globals_;
+    const char* data_;
+    std::vector<std::shared_ptr<Object>> objects_;
+    std::vector<std::shared_ptr<Scope>> scopes_;
+    std::vector<bool> visiting_;
+};
+
+}  // namespace
+
+void WriteSnapshot(Environment* environment, const std::string& path) {
+    auto bindings = environment->GetBindings();
+    std::sort(bindings.begin(), bindings.end());
+    Writer writer;
+    for (const auto& [name, value] : bindings) {
+        auto builtin = GetBuiltins().find(name);
+        if (builtin == GetBuiltins().end() || builtin->second != value) {
+            writer.AddGlobal(name, value);
+        }
+    }
+    writer.Save(path);
+}
+
+void ReadSnapshot(Environment* environment, const std::string& path) {
+    Mapping mapping(path);
+    Reader(mapping.GetData(), mapping.GetSize()).Load(environment);
+}
+
+void ReadSnapshot(Environment* environment, std::span<const char> image) {
+    Reader(image.data(), image.size()).Load(environment);
+}
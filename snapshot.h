@@ -0,0 +1,21 @@
+#pragma once
+
+#include <span>
+#include <string>
+
+#include "object.h"
+
+// Heap snapshots. A snapshot holds the globals of an environment that differ from the builtins,
+// together with every object reachable from them: data, closures with their scopes, memoized
+// functions and promises. Objects refer to each other by index and to names by offset, so the
+// file is position independent and is mapped read-only when loaded. Loading rebuilds the
+// objects directly, without reading or evaluating any code. Caches of memoized functions are
+// not saved, and futures cannot be saved.
+
+void WriteSnapshot(Environment* environment, const std::string& path);
+
+void ReadSnapshot(Environment* environment, const std::string& path);
+
+// Same, from a snapshot already in memory, such as one embedded in the program. The image must
+// be aligned to 8 bytes.
+void ReadSnapshot(Environment* environment, std::span<const char> image);
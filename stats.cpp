@@ -0,0 +1,219 @@
+#include "stats.h"
+#include "object.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+thread_local constinit EvalCounters eval_counters;
+thread_local constinit StatsCollector* current_stats = nullptr;
+
+namespace {
+
+void AddCounters(const EvalCounters& from, EvalCounters* to) {
+    for (size_t slot = 0; slot < kCallSlots; ++slot) {
+        to->calls[slot] += from.calls[slot];
+    }
+    to->callee_cache_hits += from.callee_cache_hits;
+    to->callee_cache_misses += from.callee_cache_misses;
+    to->memo_hits += from.memo_hits;
+    to->memo_misses += from.memo_misses;
+    to->allocations += from.allocations;
+    to->allocated_bytes += from.allocated_bytes;
+    to->frees += from.frees;
+    to->freed_bytes += from.freed_bytes;
+}
+
+class PrometheusWriter {
+public:
+    // Starts a metric family. Every family is written with its samples right after it.
+    void Family(const char* name, const char* type, const char* help) {
+        out_ += std::string("# HELP scheme_") + name + " " + help + "\n";
+        out_ += std::string("# TYPE scheme_") + name + " " + type + "\n";
+    }
+
+    void Sample(const char* name, double value, const std::string& labels = "") {
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.17g", value);
+        out_ += std::string("scheme_") + name + labels + " " + number + "\n";
+    }
+
+    std::string Take() {
+        return std::move(out_);
+    }
+
+private:
+    std::string out_;
+};
+
+std::string Label(const char* name, const std::string& value) {
+    std::string result = std::string("{") + name + "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            result += '\\';
+            result += c;
+        } else if (c == '\n') {
+            result += "\\n";
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"}";
+}
+
+double Seconds(std::chrono::nanoseconds time) {
+    return std::chrono::duration<double>(time).count();
+}
+
+}  // namespace
+
+InterpreterStats& InterpreterStats::operator+=(const InterpreterStats& other) {
+    runs += other.runs;
+    failed_runs += other.failed_runs;
+    evaluations += other.evaluations;
+    for (const auto& [name, calls] : other.builtin_calls) {
+        builtin_calls[name] += calls;
+    }
+    callee_cache_hits += other.callee_cache_hits;
+    callee_cache_misses += other.callee_cache_misses;
+    memo_hits += other.memo_hits;
+    memo_misses += other.memo_misses;
+    allocations += other.allocations;
+    allocated_bytes += other.allocated_bytes;
+    frees += other.frees;
+    freed_bytes += other.freed_bytes;
+    heap_bytes += other.heap_bytes;
+    peak_heap_bytes = std::max(peak_heap_bytes, other.peak_heap_bytes);
+    parse_time += other.parse_time;
+    eval_time += other.eval_time;
+    last_parse_time = std::max(last_parse_time, other.last_parse_time);
+    last_eval_time = std::max(last_eval_time, other.last_eval_time);
+    return *this;
+}
+
+std::string ToPrometheus(const InterpreterStats& stats) {
+    PrometheusWriter out;
+    out.Family("runs_total", "counter", "Programs run.");
+    out.Sample("runs_total", stats.runs);
+    out.Family("failed_runs_total", "counter", "Programs that raised an error.");
+    out.Sample("failed_runs_total", stats.failed_runs);
+    out.Family("evaluations_total", "counter", "Procedure applications.");
+    out.Sample("evaluations_total", stats.evaluations);
+    out.Family("builtin_calls_total", "counter", "Applications of each builtin.");
+    for (const auto& [name, calls] : stats.builtin_calls) {
+        out.Sample("builtin_calls_total", calls, Label("builtin", name));
+    }
+    out.Family("callee_cache_total", "counter", "Global callee lookups by call site cache result.");
+    out.Sample("callee_cache_total", stats.callee_cache_hits, Label("result", "hit"));
+    out.Sample("callee_cache_total", stats.callee_cache_misses, Label("result", "miss"));
+    out.Family("memo_cache_total", "counter", "Memoized calls by cache result.");
+    out.Sample("memo_cache_total", stats.memo_hits, Label("result", "hit"));
+    out.Sample("memo_cache_total", stats.memo_misses, Label("result", "miss"));
+    out.Family("allocations_total", "counter", "Heap allocations.");
+    out.Sample("allocations_total", stats.allocations);
+    out.Family("allocated_bytes_total", "counter", "Bytes allocated on the heap.");
+    out.Sample("allocated_bytes_total", stats.allocated_bytes);
+    out.Family("frees_total", "counter", "Heap allocations released.");
+    out.Sample("frees_total", stats.frees);
+    out.Family("freed_bytes_total", "counter", "Bytes released from the heap.");
+    out.Sample("freed_bytes_total", stats.freed_bytes);
+    out.Family("heap_bytes", "gauge", "Bytes of live objects.");
+    out.Sample("heap_bytes", stats.heap_bytes);
+    out.Family("peak_heap_bytes", "gauge", "Most bytes of live objects during a run.");
+    out.Sample("peak_heap_bytes", stats.peak_heap_bytes);
+    out.Family("phase_seconds_total", "counter", "Time spent in each phase of the runs.");
+    out.Sample("phase_seconds_total", Seconds(stats.parse_time), Label("phase", "parse"));
+    out.Sample("phase_seconds_total", Seconds(stats.eval_time), Label("phase", "eval"));
+    out.Family("last_run_phase_seconds", "gauge", "Time spent in each phase of the last run.");
+    out.Sample("last_run_phase_seconds", Seconds(stats.last_parse_time), Label("phase", "parse"));
+    out.Sample("last_run_phase_seconds", Seconds(stats.last_eval_time), Label("phase", "eval"));
+    return out.Take();
+}
+
+void StatsCollector::Collect(EvalCounters* counters) {
+    {
+        std::lock_guard lock(mutex_);
+        AddCounters(*counters, &counters_);
+    }
+    *counters = {};
+}
+
+void StatsCollector::AddRun(bool failed, std::chrono::nanoseconds parse_time,
+                            std::chrono::nanoseconds eval_time, size_t peak_bytes) {
+    std::lock_guard lock(mutex_);
+    ++stats_.runs;
+    stats_.failed_runs += failed;
+    stats_.parse_time += parse_time;
+    stats_.eval_time += eval_time;
+    stats_.last_parse_time = parse_time;
+    stats_.last_eval_time = eval_time;
+    stats_.peak_heap_bytes = std::max(stats_.peak_heap_bytes, peak_bytes);
+}
+
+InterpreterStats StatsCollector::Get() const {
+    const auto& names = GetCallSlotNames();
+    std::lock_guard lock(mutex_);
+    auto stats = stats_;
+    for (size_t slot = 0; slot < kCallSlots; ++slot) {
+        stats.evaluations += counters_.calls[slot];
+        if (slot && slot < names.size() && counters_.calls[slot]) {
+            stats.builtin_calls[names[slot]] = counters_.calls[slot];
+        }
+    }
+    stats.callee_cache_hits = counters_.callee_cache_hits;
+    stats.callee_cache_misses = counters_.callee_cache_misses;
+    stats.memo_hits = counters_.memo_hits;
+    stats.memo_misses = counters_.memo_misses;
+    stats.allocations = counters_.allocations;
+    stats.allocated_bytes = counters_.allocated_bytes;
+    stats.frees = counters_.frees;
+    stats.freed_bytes = counters_.freed_bytes;
+    return stats;
+}
+
+void FlushEvalCounters() {
+    if (current_stats) {
+        current_stats->Collect(&eval_counters);
+    } else {
+        eval_counters = {};
+    }
+}
+
+MetricsExporter::MetricsExporter(std::string path, std::chrono::milliseconds period,
+                                 std::function<std::string()> render)
+    : path_(std::move(path)), period_(period), render_(std::move(render)) {
+    thread_ = std::thread([this] {
+        std::unique_lock lock(mutex_);
+        while (!wake_.wait_for(lock, period_, [this] { return stop_; })) {
+            lock.unlock();
+            Write();
+            lock.lock();
+        }
+    });
+}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    Write();
+}
+
+bool MetricsExporter::Write() {
+    std::lock_guard lock(write_mutex_);
+    auto temp = path_ + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        out << render_();
+        if (!out.flush()) {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp, path_, error);
+    return !error;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Counters of an interpreter over all of its runs.
+struct InterpreterStats {
+    uint64_t runs = 0;
+    uint64_t failed_runs = 0;
+    // Procedure applications, and the applications of each builtin among them.
+    uint64_t evaluations = 0;
+    std::map<std::string, uint64_t> builtin_calls;
+    // Applications of a global whose binding was cached by the call site, and of those that
+    // had to look it up.
+    uint64_t callee_cache_hits = 0;
+    uint64_t callee_cache_misses = 0;
+    uint64_t memo_hits = 0;
+    uint64_t memo_misses = 0;
+    // Objects are reference counted, so there are no collection cycles or pauses: memory is
+    // released as soon as it is garbage and shows up as frees.
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t frees = 0;
+    uint64_t freed_bytes = 0;
+    size_t heap_bytes = 0;
+    size_t peak_heap_bytes = 0;
+    // Reading and optimizing programs, and evaluating and printing them.
+    std::chrono::nanoseconds parse_time{};
+    std::chrono::nanoseconds eval_time{};
+    std::chrono::nanoseconds last_parse_time{};
+    std::chrono::nanoseconds last_eval_time{};
+
+    // Sums the counters of several interpreters. Peaks and the last run take the maximum.
+    InterpreterStats& operator+=(const InterpreterStats& other);
+};
+
+// The stats in the Prometheus text format, every metric prefixed with scheme_.
+std::string ToPrometheus(const InterpreterStats& stats);
+
+// Builtins get slots 1 and up in the call counters; slot 0 counts every other function.
+constexpr size_t kCallSlots = 128;
+
+// Counted by the evaluator without synchronization on the thread it runs on, and handed to the
+// interpreter's StatsCollector when a run ends, a scheduled task yields or a parallel task is
+// done.
+struct EvalCounters {
+    std::array<uint64_t, kCallSlots> calls{};
+    uint64_t callee_cache_hits = 0;
+    uint64_t callee_cache_misses = 0;
+    uint64_t memo_hits = 0;
+    uint64_t memo_misses = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t frees = 0;
+    uint64_t freed_bytes = 0;
+};
+
+extern thread_local constinit EvalCounters eval_counters;
+
+class StatsCollector {
+public:
+    // Adds the counters and resets them.
+    void Collect(EvalCounters* counters);
+
+    void AddRun(bool failed, std::chrono::nanoseconds parse_time,
+                std::chrono::nanoseconds eval_time, size_t peak_bytes);
+
+    // Everything but the live heap, which only the interpreter knows.
+    InterpreterStats Get() const;
+
+private:
+    mutable std::mutex mutex_;
+    EvalCounters counters_;
+    InterpreterStats stats_;
+};
+
+// Collector of the interpreter running on this thread.
+extern thread_local constinit StatsCollector* current_stats;
+
+// Hands the counters of this thread to the current collector, or drops them when there is none.
+void FlushEvalCounters();
+
+class StatsGuard {
+public:
+    StatsGuard(StatsCollector* stats) : saved_(current_stats) {
+        FlushEvalCounters();
+        current_stats = stats;
+    }
+
+    ~StatsGuard() {
+        FlushEvalCounters();
+        current_stats = saved_;
+    }
+
+private:
+    StatsCollector* saved_;
+};
+
+// Writes the page rendered by `render` to a file every period from its own thread, and once
+// more when destroyed. The file is replaced with a rename, so a scraper never sees half of it.
+class MetricsExporter {
+public:
+    MetricsExporter(std::string path, std::chrono::milliseconds period,
+                    std::function<std::string()> render);
+
+    ~MetricsExporter();
+
+    bool Write();
+
+private:
+    std::string path_;
+    std::chrono::milliseconds period_;
+    std::function<std::string()> render_;
+    std::mutex write_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
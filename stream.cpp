@@ -0,0 +1,98 @@
+#include "stream.h"
+
+namespace {
+
+std::shared_ptr<Promise> MakePromise(const std::shared_ptr<Object>& expr) {
+    if (!expr) {
+        throw SyntaxError();
+    }
+    return Make<Promise>(As<Function>(MakeClosure(nullptr, {expr})));
+}
+
+std::shared_ptr<Cell> GetStream(const std::shared_ptr<Object>& head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1 || !Is<Cell>(args[0])) {
+        throw RuntimeError();
+    }
+    return As<Cell>(args[0]);
+}
+
+}  // namespace
+
+std::shared_ptr<Object> Promise::Force() {
+    std::unique_lock lock(mutex_);
+    if (thunk_) {
+        auto thunk = thunk_;
+        lock.unlock();
+        auto value = thunk->Call({});
+        lock.lock();
+        // A promise forced again from inside its own thunk, or by another thread, keeps the
+        // first value.
+        if (thunk_) {
+            value_ = std::move(value);
+            thunk_.reset();
+        }
+    }
+    return value_;
+}
+
+std::pair<std::shared_ptr<Function>, std::shared_ptr<Object>> Promise::GetState() {
+    std::lock_guard lock(mutex_);
+    return {thunk_, value_};
+}
+
+void Promise::Restore(std::shared_ptr<Function> thunk, std::shared_ptr<Object> value) {
+    std::lock_guard lock(mutex_);
+    thunk_ = std::move(thunk);
+    value_ = std::move(value);
+}
+
+std::shared_ptr<Object> Delay::Apply(std::shared_ptr<Object> head) {
+    auto args = ToArgs(head);
+    if (args.size() != 1) {
+        throw SyntaxError();
+    }
+    return MakePromise(args[0]);
+}
+
+std::shared_ptr<Object> Force::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    if (!Is<Promise>(args[0])) {
+        return args[0];
+    }
+    return As<Promise>(args[0])->Force();
+}
+
+std::shared_ptr<Object> ConsStream::Apply(std::shared_ptr<Object> head) {
+    auto args = ToArgs(head);
+    if (args.size() != 2) {
+        throw SyntaxError();
+    }
+    if (!args[0]) {
+        throw RuntimeError();
+    }
+    return Make<Cell>(args[0]->Eval(), MakePromise(args[1]));
+}
+
+std::shared_ptr<Object> StreamCar::Apply(std::shared_ptr<Object> head) {
+    return GetStream(head)->GetFirst();
+}
+
+std::shared_ptr<Object> StreamCdr::Apply(std::shared_ptr<Object> head) {
+    auto tail = GetStream(head)->GetSecond();
+    if (!Is<Promise>(tail)) {
+        throw RuntimeError();
+    }
+    return As<Promise>(tail)->Force();
+}
+
+std::shared_ptr<Object> StreamNull::Apply(std::shared_ptr<Object> head) {
+    auto args = EvalArgs(head);
+    if (args.size() != 1) {
+        throw RuntimeError();
+    }
+    return Make<Boolean>(!args[0]);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "object.h"
+
+// Memoizing promise. The delayed expression is kept as a thunk and released once forced, so a
+// forced stream cell no longer holds on to the environment it was built in.
+class Promise : public Object {
+public:
+    Promise(std::shared_ptr<Function> thunk) : thunk_(std::move(thunk)) {
+    }
+
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+
+    std::shared_ptr<Object> Force();
+
+    // The thunk is nullptr once the promise has been forced.
+    std::pair<std::shared_ptr<Function>, std::shared_ptr<Object>> GetState();
+
+    void Restore(std::shared_ptr<Function> thunk, std::shared_ptr<Object> value);
+
+private:
+    std::mutex mutex_;
+    std::shared_ptr<Function> thunk_;
+    std::shared_ptr<Object> value_;
+};
+
+class Delay : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class Force : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class ConsStream : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class StreamCar : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class StreamCdr : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
+
+class StreamNull : public Function {
+public:
+    std::shared_ptr<Object> Apply(std::shared_ptr<Object> head) override;
+};
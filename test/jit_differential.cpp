@@ -0,0 +1,8 @@
+#include "../compiler.h"
+
+// Runs the basic and advanced suites with every closure compiled on its first call and each
+// compiled result checked against the interpreter.
+static const bool kDifferential = [] {
+    SetJitDifferential(true);
+    return true;
+}();
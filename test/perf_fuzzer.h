@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../scheme.h"
+
+constexpr uint32_t kPerfSeed = 16;
+
+// Generates valid programs from a small Scheme grammar. Unlike Fuzzer, which looks for crashes
+// in token soup, the programs are meant to be scaled up: each shape makes a program of a given
+// size, so the cost of running it can be compared across sizes.
+class ProgramGenerator {
+public:
+    explicit ProgramGenerator(uint32_t seed = kPerfSeed) : gen_(seed) {
+    }
+
+    void Reset(uint32_t seed = kPerfSeed) {
+        gen_.seed(seed);
+    }
+
+    std::string Number() {
+        return std::to_string(std::uniform_int_distribution<int>(-99, 99)(gen_));
+    }
+
+    // A quotable datum: a number, boolean, symbol or a list of data at most `depth` deep.
+    std::string Datum(size_t depth) {
+        switch (Pick(depth ? 5 : 3)) {
+            case 0:
+                return Number();
+            case 1:
+                return Pick(2) ? "#t" : "#f";
+            case 2:
+                return kSymbols[Pick(std::size(kSymbols))];
+            default: {
+                std::string list = "(";
+                for (size_t i = 0, size = Pick(4); i < size; ++i) {
+                    list += (i ? " " : "") + Datum(depth - 1);
+                }
+                return list + ")";
+            }
+        }
+    }
+
+    // A numeric expression at most `depth` deep. Operators are chosen so it never overflows.
+    std::string Expression(size_t depth) {
+        if (!depth || !Pick(3)) {
+            return Number();
+        }
+        std::string op = kOperators[Pick(std::size(kOperators))];
+        std::string expression = "(" + op;
+        for (size_t i = 0, size = op == "abs" ? 1 : 1 + Pick(3); i < size; ++i) {
+            expression += " " + Expression(depth - 1);
+        }
+        return expression + ")";
+    }
+
+    // Numbers or data separated by spaces.
+    std::string Sequence(size_t size, bool numbers) {
+        std::string result;
+        for (size_t i = 0; i < size; ++i) {
+            result += (i ? " " : "") + (numbers ? Number() : Datum(2));
+        }
+        return result;
+    }
+
+private:
+    static constexpr const char* kSymbols[] = {"a", "list", "x->y", "+", "long-symbol-name"};
+    static constexpr const char* kOperators[] = {"min", "max", "abs"};
+
+    size_t Pick(size_t count) {
+        return std::uniform_int_distribution<size_t>(0, count - 1)(gen_);
+    }
+
+    std::mt19937 gen_;
+};
+
+struct ProgramShape {
+    const char* name;
+    // Smallest size measured; the harness doubles it a few times.
+    size_t base_size;
+    std::function<std::string(ProgramGenerator*, size_t)> make;
+};
+
+inline std::vector<ProgramShape> GetProgramShapes() {
+    return {
+        {"wide-list", 2000,
+         [](ProgramGenerator* gen, size_t n) {
+             return "(list? '(" + gen->Sequence(n, false) + "))";
+         }},
+        {"wide-vector", 2000,
+         [](ProgramGenerator* gen, size_t n) {
+             return "(vector-length (list->vector '(" + gen->Sequence(n, false) + ")))";
+         }},
+        {"long-arguments", 1000,
+         [](ProgramGenerator* gen, size_t n) {
+             std::string program = "(max";
+             for (size_t i = 0; i < n; ++i) {
+                 program += " " + gen->Expression(2);
+             }
+             return program + ")";
+         }},
+        {"apply", 2000,
+         [](ProgramGenerator* gen, size_t n) {
+             return "(apply + '(" + gen->Sequence(n, true) + "))";
+         }},
+        {"list-tail", 2000,
+         [](ProgramGenerator* gen, size_t n) {
+             return "(list-tail '(" + gen->Sequence(n, true) + ") " + std::to_string(n - 1) + ")";
+         }},
+        {"list-ref", 2000,
+         [](ProgramGenerator* gen, size_t n) {
+             return "(list-ref '(" + gen->Sequence(n, true) + ") " + std::to_string(n - 1) + ")";
+         }},
+        {"deep-nesting", 250,
+         [](ProgramGenerator* gen, size_t n) {
+             std::string program;
+             for (size_t i = 0; i < n; ++i) {
+                 program += "(max " + gen->Expression(1) + " ";
+             }
+             return program + "0" + std::string(n, ')');
+         }},
+        {"deep-data", 250,
+         [](ProgramGenerator* gen, size_t n) {
+             return "'" + std::string(n, '(') + gen->Datum(1) + std::string(n, ')');
+         }},
+        {"nested-quotes", 250,
+         [](ProgramGenerator* gen, size_t n) {
+             return std::string(n, '\'') + gen->Datum(2);
+         }},
+    };
+}
+
+struct GrowthSample {
+    size_t size;
+    double seconds;
+    uint64_t allocations;
+};
+
+// How the cost of a shape grows with its size: the slope of log cost against log size, so 1
+// is linear and 2 quadratic.
+struct Growth {
+    std::vector<GrowthSample> samples;
+    double time_exponent = 0;
+    double allocation_exponent = 0;
+};
+
+inline double FitExponent(const std::vector<GrowthSample>& samples,
+                          const std::function<double(const GrowthSample&)>& cost) {
+    double mean_x = 0;
+    double mean_y = 0;
+    for (const auto& sample : samples) {
+        mean_x += std::log(sample.size) / samples.size();
+        mean_y += std::log(std::max(cost(sample), 1e-12)) / samples.size();
+    }
+    double covariance = 0;
+    double variance = 0;
+    for (const auto& sample : samples) {
+        auto x = std::log(sample.size) - mean_x;
+        covariance += x * (std::log(std::max(cost(sample), 1e-12)) - mean_y);
+        variance += x * x;
+    }
+    return covariance / variance;
+}
+
+// Runs the shape at `steps` doublings of its base size. Each size is timed by the fastest of
+// `repetitions` runs, which filters out most of the noise of a shared machine; allocations are
+// counted exactly.
+inline Growth MeasureGrowth(const ProgramShape& shape, size_t steps = 4, size_t repetitions = 3) {
+    Growth growth;
+    ProgramGenerator gen;
+    Interpreter interpreter(0);
+    for (size_t step = 0, size = shape.base_size; step < steps; ++step, size *= 2) {
+        gen.Reset();
+        auto program = shape.make(&gen, size);
+        GrowthSample sample{size, 0, 0};
+        for (size_t i = 0; i < repetitions; ++i) {
+            auto allocations = interpreter.GetStats().allocations;
+            auto start = std::chrono::steady_clock::now();
+            interpreter.Run(program);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            sample.seconds = i ? std::min(sample.seconds, elapsed.count()) : elapsed.count();
+            sample.allocations = interpreter.GetStats().allocations - allocations;
+        }
+        growth.samples.push_back(sample);
+    }
+    growth.time_exponent = FitExponent(growth.samples, [](auto& s) { return s.seconds; });
+    growth.allocation_exponent =
+        FitExponent(growth.samples, [](auto& s) { return double(s.allocations); });
+    return growth;
+}
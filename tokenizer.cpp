@@ -1,22 +1,38 @@
 #include "tokenizer.h"
 #include "error.h"
 
-std::unordered_set<char> special = {'<', '=', '>', '*', '/', '#'};
-std::unordered_set<char> enlarged = {'?', '!', '-'};
+#include <charconv>
+
+const std::unordered_set<char> special = {'<', '=', '>', '*', '/', '#'};
+const std::unordered_set<char> enlarged = {'?', '!', '-'};
 
 Tokenizer::Tokenizer(std::istream *in) : in_(in) {
     Next();
 }
 
+Tokenizer::Tokenizer(std::istream *in, std::nothrow_t) : in_(in) {
+    TryNext();
+}
+
 void Tokenizer::Next() {
+    if (!TryNext()) {
+        throw SyntaxError();
+    }
+}
+
+bool Tokenizer::TryNext() {
+    if (failed_) {
+        return false;
+    }
     while (std::isspace(in_->peek())) {
-        in_->get();
+        Get();
     }
+    token_offset_ = offset_;
     if (in_->eof()) {
         end_ = true;
-        return;
+        return true;
     }
-    char cur_char = in_->get();
+    char cur_char = Get();
     if (cur_char == '(') {
         cur_token_ = BracketToken::OPEN;
     } else if (cur_char == ')') {
@@ -25,13 +41,37 @@ void Tokenizer::Next() {
         cur_token_ = DotToken();
     } else if (cur_char == '\'') {
         cur_token_ = QuoteToken();
+    } else if (cur_char == '"') {
+        std::string value;
+        while (true) {
+            auto next = Get();
+            if (next == '\\') {
+                next = Get();
+                if (next == 'n') {
+                    next = '\n';
+                } else if (next == 't') {
+                    next = '\t';
+                } else if (next != '"' && next != '\\') {
+                    token_offset_ = offset_ - 2;
+                    failed_ = true;
+                    return false;
+                }
+            } else if (next == '"') {
+                break;
+            } else if (next == std::char_traits<char>::eof()) {
+                failed_ = true;
+                return false;
+            }
+            value.push_back(next);
+        }
+        cur_token_ = StringToken{std::move(value)};
     } else if (std::isalpha(cur_char) || special.contains(cur_char) ||
                ((cur_char == '-' || cur_char == '+') && !std::isdigit(in_->peek()))) {
         std::string new_token;
         new_token.push_back(cur_char);
         while (std::isalpha(in_->peek()) || std::isdigit(in_->peek()) ||
                special.contains(in_->peek()) || enlarged.contains(in_->peek())) {
-            new_token.push_back(in_->get());
+            new_token.push_back(Get());
         }
         cur_token_ = SymbolToken{new_token};
     } else if (((cur_char == '-' || cur_char == '+') && std::isdigit(in_->peek())) ||
@@ -39,12 +79,22 @@ void Tokenizer::Next() {
         std::string new_token;
         new_token.push_back(cur_char);
         while (std::isdigit(in_->peek())) {
-            new_token.push_back(in_->get());
+            new_token.push_back(Get());
+        }
+        // Numbers that do not fit a fixnum are rejected like any other malformed token.
+        auto begin = new_token.data() + (cur_char == '+');
+        int64_t value = 0;
+        auto [end, error] = std::from_chars(begin, new_token.data() + new_token.size(), value);
+        if (error != std::errc()) {
+            failed_ = true;
+            return false;
         }
-        cur_token_ = ConstantToken{std::stoi(new_token)};
+        cur_token_ = ConstantToken{value};
     } else {
-        throw SyntaxError();
+        failed_ = true;
+        return false;
     }
+    return true;
 }
 
 Token Tokenizer::GetToken() {
@@ -69,4 +119,8 @@ bool DotToken::operator==(const DotToken &) const {
 
 bool ConstantToken::operator==(const ConstantToken &other) const {
     return value_ == other.value_;
+}
+
+bool StringToken::operator==(const StringToken &other) const {
+    return value_ == other.value_;
 }
\ No newline at end of file
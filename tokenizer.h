@@ -2,7 +2,11 @@
 
 #include <variant>
 #include <optional>
+#include <cstddef>
+#include <cstdint>
 #include <istream>
+#include <new>
+#include <string>
 #include <unordered_set>
 
 struct SymbolToken {
@@ -27,20 +31,53 @@ struct ConstantToken {
     bool operator==(const ConstantToken& other) const;
 };
 
-using Token = std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken>;
+struct StringToken {
+    std::string value_;
+
+    bool operator==(const StringToken& other) const;
+};
+
+using Token =
+    std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken, StringToken>;
 
 class Tokenizer {
 public:
+    // Throws SyntaxError when the input starts with a character no token starts with.
     Tokenizer(std::istream* in);
 
+    // Reports such a character with HasFailed instead.
+    Tokenizer(std::istream* in, std::nothrow_t);
+
     bool IsEnd();
 
     void Next();
 
+    // Same as Next, but returns false instead of throwing. A tokenizer that failed stays at the
+    // offending character.
+    bool TryNext();
+
+    bool HasFailed() const {
+        return failed_;
+    }
+
     Token GetToken();
 
+    // Offset in the input of the current token, of the offending character after a failure, or
+    // of the end.
+    size_t GetOffset() const {
+        return token_offset_;
+    }
+
 private:
+    int Get() {
+        ++offset_;
+        return in_->get();
+    }
+
     std::istream* in_;
     Token cur_token_;
     bool end_ = false;
+    bool failed_ = false;
+    size_t offset_ = 0;
+    size_t token_offset_ = 0;
 };
\ No newline at end of file
@@ -143,6 +143,19 @@ TEST_CASE("Literal strings are handled correctly") {
     }
 }
 
+TEST_CASE("String tokens") {
+    std::stringstream ss{R"EOF("a (b)" "say \"hi\"\n" "" "bad\q")EOF"};
+    Tokenizer tokenizer{&ss, std::nothrow};
+
+    REQUIRE(tokenizer.GetToken() == Token{StringToken{"a (b)"}});
+    REQUIRE(tokenizer.TryNext());
+    REQUIRE(tokenizer.GetToken() == Token{StringToken{"say \"hi\"\n"}});
+    REQUIRE(tokenizer.TryNext());
+    REQUIRE(tokenizer.GetToken() == Token{StringToken{""}});
+    REQUIRE(!tokenizer.TryNext());
+    REQUIRE(tokenizer.GetOffset() == 30);
+}
+
 TEST_CASE("Empty string handled correctly") {
     std::stringstream ss;
     Tokenizer tokenizer{&ss};